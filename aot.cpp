@@ -0,0 +1,577 @@
+#include "aot.h"
+#include "scheme.h"
+
+#include <dlfcn.h>
+
+#include <deque>
+#include <set>
+
+struct AotContext {
+    // the values made during the call, handles point into it
+    std::deque<std::shared_ptr<Object>> values;
+    const std::vector<std::shared_ptr<Object>>* constants;
+    const std::vector<std::shared_ptr<Object>>* builtins;
+};
+
+namespace {
+
+// builtins that evaluate all their arguments in order before looking at them,
+// so they may be called with values computed by the compiled code
+const std::set<std::string> kStrictBuiltins = {
+    "pair?",         "null?",           "list?",          "cons",
+    "list",          "list-ref",        "list-tail",      "=",
+    ">",             "<",               ">=",             "<=",
+    "+",             "-",               "*",              "/",
+    "max",           "min",             "abs",            "make-vector",
+    "vector",        "vector-ref",      "vector-set!",    "vector-length",
+    "vector-sum",    "vector-min",      "vector-max",     "vector-add",
+    "vector-mul",    "vector-dot",      "hash-table-ref", "hash-table-set!",
+    "hash-table-delete!", "hash-table-count", "par-map",  "par-reduce",
+    "sort",          "force",           "stream-car",     "stream-cdr",
+    "stream-take",   "stream-map",      "stream-filter",  "string-length",
+    "string-ref",    "substring",       "string-append",  "string->symbol"};
+// the same, but only when called without arguments
+const std::set<std::string> kNullaryBuiltins = {"make-hash-table", "profile-report",
+                                                "memory-stats"};
+
+// ---------------------------------------------------------------------------------
+// the compiler
+
+enum class Kind { INT, BOOL, VALUE };
+
+struct Compiled {
+    Kind kind;
+    // a literal or a temporary, never an expression with side effects
+    std::string expr;
+};
+
+// a C++ string literal. bytes other than printable ascii are written as octal escapes,
+// which take at most three digits, so a digit after one can't extend it
+std::string Quote(const std::string& str) {
+    std::string res = "\"";
+    for (char ch : str) {
+        auto byte = static_cast<unsigned char>(ch);
+        if (ch == '"' || ch == '\\') {
+            res += '\\';
+            res += ch;
+        } else if (byte < 0x20 || byte >= 0x7f) {
+            res += '\\';
+            res += static_cast<char>('0' + (byte >> 6));
+            res += static_cast<char>('0' + ((byte >> 3) & 7));
+            res += static_cast<char>('0' + (byte & 7));
+        } else {
+            res += ch;
+        }
+    }
+    return res + "\"";
+}
+
+std::string IntLiteral(int64_t value) {
+    if (value == INT64_MIN) {
+        return "INT64_MIN";
+    }
+    return "int64_t{" + std::to_string(value) + "}";
+}
+
+// the elements of a proper list without empty lists among them,
+// false for anything else
+bool GetArgs(const std::shared_ptr<Object>& args, std::vector<std::shared_ptr<Object>>* out) {
+    for (auto cur = args; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur) || !As<Cell>(cur)->GetFirst()) {
+            return false;
+        }
+        out->push_back(As<Cell>(cur)->GetFirst());
+    }
+    return true;
+}
+
+class EntryCompiler {
+public:
+    explicit EntryCompiler(const std::shared_ptr<Object>& expr) : expr_(expr) {
+        AddConstant(expr);
+    }
+
+    std::string Compile(const std::string& ns, const std::string& name) {
+        auto res = CompileExpr(expr_);
+        Line("return " + Box(res) + ";");
+        auto body = std::move(code_);
+
+        std::string out = "namespace " + ns + " {\n\n";
+        out += "const char* const kConstants[] = {";
+        for (size_t i = 0; i < constants_.size(); ++i) {
+            out += (i ? ", " : "") + Quote(constants_[i]);
+        }
+        out += "};\nconst size_t kConstantSizes[] = {";
+        for (size_t i = 0; i < constants_.size(); ++i) {
+            out += (i ? ", " : "") + std::to_string(constants_[i].size());
+        }
+        out += "};\nconst char* const kBuiltins[] = {";
+        for (size_t i = 0; i < builtins_.size(); ++i) {
+            out += (i ? ", " : "") + Quote(builtins_[i]);
+        }
+        out += builtins_.empty() ? "nullptr};\n\n" : "};\n\n";
+        out += "AotValue Run(AotContext* ctx, const AotRuntime* rt) {\n" + body + "}\n\n";
+        out += "}  // namespace " + ns + "\n\n";
+
+        entry_ = "{" + Quote(name) + ", " + ns + "::Run, " + ns + "::kConstants, " + ns +
+                 "::kConstantSizes, " + std::to_string(constants_.size()) + ", " + ns +
+                 "::kBuiltins, " + std::to_string(builtins_.size()) + "}";
+        return out;
+    }
+
+    // the initializer of the AotEntry, after Compile
+    const std::string& GetEntry() const {
+        return entry_;
+    }
+
+private:
+    Compiled CompileExpr(const std::shared_ptr<Object>& expr) {
+        if (Is<Number>(expr)) {
+            return {Kind::INT, IntLiteral(As<Number>(expr)->GetValue())};
+        } else if (Is<Bool>(expr)) {
+            return {Kind::BOOL, As<Bool>(expr)->IsTrue() ? "true" : "false"};
+        } else if (!Is<Cell>(expr) || !Is<Symbol>(As<Cell>(expr)->GetFirst())) {
+            return Fallback(expr);
+        }
+
+        auto& name = As<Symbol>(As<Cell>(expr)->GetFirst())->GetName();
+        auto tail = As<Cell>(expr)->GetSecond();
+        std::vector<std::shared_ptr<Object>> args;
+        if (name == "quote") {
+            if (Is<Cell>(tail) && !As<Cell>(tail)->GetSecond()) {
+                AddBuiltin(name);
+                return CompileConstant(As<Cell>(tail)->GetFirst());
+            }
+        } else if (name == "car" || name == "cdr") {
+            // the argument must be a call, only the first one is looked at
+            if (Is<Cell>(tail) && Is<Cell>(As<Cell>(tail)->GetFirst())) {
+                AddBuiltin(name);
+                auto value = Box(CompileExpr(As<Cell>(tail)->GetFirst()));
+                return Temp(Kind::VALUE, "rt->" + name + "(ctx, " + value + ")");
+            }
+        } else if (!GetArgs(tail, &args)) {
+            return Fallback(expr);
+        } else if (name == "and" || name == "or") {
+            AddBuiltin(name);
+            return name == "and" ? CompileAnd(args) : CompileOr(args);
+        } else if (kStrictBuiltins.count(name) || (kNullaryBuiltins.count(name) && args.empty())) {
+            auto builtin = AddBuiltin(name);
+            std::vector<Compiled> values;
+            for (auto& arg : args) {
+                values.push_back(CompileExpr(arg));
+            }
+            return CompileStrict(name, builtin, values);
+        }
+        return Fallback(expr);
+    }
+
+    Compiled CompileConstant(const std::shared_ptr<Object>& datum) {
+        if (Is<Number>(datum) || Is<Bool>(datum)) {
+            return CompileExpr(datum);
+        }
+        return Temp(Kind::VALUE, "rt->constant(ctx, " + std::to_string(AddConstant(datum)) + ")");
+    }
+
+    Compiled Fallback(const std::shared_ptr<Object>& expr) {
+        return Temp(Kind::VALUE, "rt->eval(ctx, " + std::to_string(AddConstant(expr)) + ")");
+    }
+
+    Compiled CompileStrict(const std::string& name, size_t builtin,
+                           const std::vector<Compiled>& values) {
+        size_t n = values.size();
+        bool arithmetic = name == "+" || name == "*" || (name == "-" && n >= 2) ||
+                          (name == "/" && n >= 2) || ((name == "max" || name == "min") && n >= 1) ||
+                          (name == "abs" && n == 1);
+        bool comparison =
+            (name == "=" || name == "<" || name == ">" || name == "<=" || name == ">=") && n != 1;
+        bool has_bool = false;
+        for (auto& value : values) {
+            has_bool |= value.kind == Kind::BOOL;
+        }
+        // a division by a literal zero is left to the builtin, which throws
+        for (size_t i = 1; name == "/" && i < n; ++i) {
+            arithmetic &= values[i].expr != IntLiteral(0);
+        }
+
+        if ((arithmetic || comparison) && !has_bool) {
+            return CompileNumeric(name, builtin, values, comparison ? Kind::BOOL : Kind::INT);
+        } else if (name == "cons" && n == 2) {
+            return Temp(Kind::VALUE,
+                        "rt->cons(ctx, " + Box(values[0]) + ", " + Box(values[1]) + ")");
+        }
+        return Temp(Kind::VALUE, Apply(builtin, values));
+    }
+
+    // unboxed when all the arguments turn out to be numbers, otherwise the builtin
+    // itself decides, e.g. sums a vector or throws the same error as the interpreter
+    Compiled CompileNumeric(const std::string& name, size_t builtin,
+                            const std::vector<Compiled>& values, Kind kind) {
+        std::vector<std::string> unboxed;
+        std::string check;
+        for (auto& value : values) {
+            if (value.kind == Kind::INT) {
+                unboxed.push_back(value.expr);
+            } else {
+                check += (check.empty() ? "" : " && ") + ("rt->is_number(" + value.expr + ")");
+                unboxed.push_back("rt->number_value(" + value.expr + ")");
+            }
+        }
+
+        auto res = NewTemp();
+        auto type = kind == Kind::INT ? "int64_t " : "bool ";
+        if (check.empty()) {
+            EmitNumeric(name, unboxed, std::string("const ") + type + res + " = ");
+            return {kind, res};
+        }
+
+        Line(type + res + ";");
+        Line("if (" + check + ") {");
+        ++indent_;
+        for (auto& value : unboxed) {
+            if (value.rfind("rt->", 0) == 0) {
+                auto temp = NewTemp();
+                Line("const int64_t " + temp + " = " + value + ";");
+                value = temp;
+            }
+        }
+        EmitNumeric(name, unboxed, res + " = ");
+        --indent_;
+        Line("} else {");
+        ++indent_;
+        auto call = Apply(builtin, values);
+        if (kind == Kind::INT) {
+            Line(res + " = rt->number_value(" + call + ");");
+        } else {
+            Line(res + " = !rt->is_false(" + call + ");");
+        }
+        --indent_;
+        Line("}");
+        return {kind, res};
+    }
+
+    void EmitNumeric(const std::string& name, const std::vector<std::string>& args,
+                     const std::string& assign) {
+        std::string res;
+        if (name == "=" || name == "<" || name == ">" || name == "<=" || name == ">=") {
+            auto op = name == "=" ? "==" : name;
+            for (size_t i = 1; i < args.size(); ++i) {
+                res += (i > 1 ? " && " : "") + ("(" + args[i - 1] + " " + op + " " + args[i] + ")");
+            }
+            Line(assign + (res.empty() ? "true" : res) + ";");
+            return;
+        }
+        if (name == "/") {
+            for (size_t i = 1; i < args.size(); ++i) {
+                Line("if (" + args[i] + " == 0) {");
+                Line("    rt->fail(ctx, \"division by zero\");");
+                Line("}");
+            }
+        }
+        if (name == "abs") {
+            Line(assign + "AotAbs(" + args[0] + ");");
+            return;
+        }
+        static const std::map<std::string, std::string> kFolds = {
+            {"+", "AotAdd"}, {"-", "AotSub"}, {"*", "AotMul"},
+            {"max", "AotMax"}, {"min", "AotMin"}};
+        if (args.empty()) {
+            res = name == "+" ? "int64_t{0}" : "int64_t{1}";
+        } else {
+            res = args[0];
+            for (size_t i = 1; i < args.size(); ++i) {
+                if (name == "/") {
+                    res = "(" + res + " / " + args[i] + ")";
+                } else {
+                    res = kFolds.at(name) + "(" + res + ", " + args[i] + ")";
+                }
+            }
+        }
+        Line(assign + res + ";");
+    }
+
+    // like the And builtin, which evaluates its last argument twice
+    Compiled CompileAnd(const std::vector<std::shared_ptr<Object>>& args) {
+        if (args.empty()) {
+            return {Kind::BOOL, "true"};
+        }
+        auto res = NewTemp();
+        Line("AotValue " + res + ";");
+        Line("do {");
+        ++indent_;
+        Compiled value;
+        for (auto& arg : args) {
+            value = CompileExpr(arg);
+            Line("if (" + IsFalse(value) + ") {");
+            Line("    " + res + " = rt->boolean(ctx, false);");
+            Line("    break;");
+            Line("}");
+        }
+        Line(res + " = " + Box(value) + ";");
+        --indent_;
+        Line("} while (false);");
+        return {Kind::VALUE, res};
+    }
+
+    Compiled CompileOr(const std::vector<std::shared_ptr<Object>>& args) {
+        if (args.empty()) {
+            return {Kind::BOOL, "false"};
+        }
+        auto res = NewTemp();
+        Line("AotValue " + res + ";");
+        Line("do {");
+        ++indent_;
+        for (auto& arg : args) {
+            auto value = CompileExpr(arg);
+            Line("if (!" + IsFalse(value) + ") {");
+            Line("    " + res + " = " + Box(value) + ";");
+            Line("    break;");
+            Line("}");
+        }
+        Line(res + " = rt->boolean(ctx, false);");
+        --indent_;
+        Line("} while (false);");
+        return {Kind::VALUE, res};
+    }
+
+    std::string Apply(size_t builtin, const std::vector<Compiled>& values) {
+        if (values.empty()) {
+            return "rt->apply(ctx, " + std::to_string(builtin) + ", 0, nullptr)";
+        }
+        auto args = NewTemp();
+        std::string list;
+        for (auto& value : values) {
+            list += (list.empty() ? "" : ", ") + Box(value);
+        }
+        Line("const AotValue " + args + "[] = {" + list + "};");
+        return "rt->apply(ctx, " + std::to_string(builtin) + ", " +
+               std::to_string(values.size()) + ", " + args + ")";
+    }
+
+    std::string Box(const Compiled& value) {
+        switch (value.kind) {
+            case Kind::INT:
+                return "rt->number(ctx, " + value.expr + ")";
+            case Kind::BOOL:
+                return "rt->boolean(ctx, " + value.expr + ")";
+            default:
+                return value.expr;
+        }
+    }
+
+    std::string IsFalse(const Compiled& value) {
+        switch (value.kind) {
+            case Kind::INT:
+                return "false";
+            case Kind::BOOL:
+                return "!" + value.expr;
+            default:
+                return "rt->is_false(" + value.expr + ")";
+        }
+    }
+
+    Compiled Temp(Kind kind, const std::string& init) {
+        auto name = NewTemp();
+        Line("const AotValue " + name + " = " + init + ";");
+        return {kind, name};
+    }
+
+    std::string NewTemp() {
+        return "t" + std::to_string(temps_++);
+    }
+
+    void Line(const std::string& line) {
+        code_ += std::string(indent_ * 4, ' ') + line + "\n";
+    }
+
+    size_t AddConstant(const std::shared_ptr<Object>& obj) {
+        auto source = RepresentAsStr(obj, true);
+        for (size_t i = 1; i < constants_.size(); ++i) {
+            if (constants_[i] == source) {
+                return i;
+            }
+        }
+        constants_.push_back(source);
+        return constants_.size() - 1;
+    }
+
+    size_t AddBuiltin(const std::string& name) {
+        for (size_t i = 0; i < builtins_.size(); ++i) {
+            if (builtins_[i] == name) {
+                return i;
+            }
+        }
+        builtins_.push_back(name);
+        return builtins_.size() - 1;
+    }
+
+    std::shared_ptr<Object> expr_;
+    std::string code_;
+    size_t indent_ = 1;
+    size_t temps_ = 0;
+    std::vector<std::string> constants_;
+    std::vector<std::string> builtins_;
+    std::string entry_;
+};
+
+// ---------------------------------------------------------------------------------
+// the runtime
+
+const std::shared_ptr<Object>& Unwrap(AotValue value) {
+    return *reinterpret_cast<const std::shared_ptr<Object>*>(value);
+}
+
+AotValue Wrap(AotContext* ctx, std::shared_ptr<Object> obj) {
+    ctx->values.push_back(std::move(obj));
+    return reinterpret_cast<AotValue>(&ctx->values.back());
+}
+
+AotValue RuntimeNumber(AotContext* ctx, int64_t value) {
+    return Wrap(ctx, std::make_shared<Number>(ConstantToken{value}));
+}
+
+AotValue RuntimeBoolean(AotContext* ctx, bool value) {
+    return Wrap(ctx, std::make_shared<Bool>(value));
+}
+
+AotValue RuntimeConstant(AotContext* ctx, size_t index) {
+    return reinterpret_cast<AotValue>(&(*ctx->constants)[index]);
+}
+
+AotValue RuntimeEval(AotContext* ctx, size_t index) {
+    return Wrap(ctx, (*ctx->constants)[index]->Eval());
+}
+
+bool RuntimeIsNumber(AotValue value) {
+    return Is<Number>(Unwrap(value));
+}
+
+int64_t RuntimeNumberValue(AotValue value) {
+    return As<Number>(Unwrap(value))->GetValue();
+}
+
+bool RuntimeIsFalse(AotValue value) {
+    auto& obj = Unwrap(value);
+    return Is<Bool>(obj) && !As<Bool>(obj)->IsTrue();
+}
+
+AotValue RuntimeCons(AotContext* ctx, AotValue first, AotValue second) {
+    auto cell = std::make_shared<Cell>();
+    cell->SetFirst(Unwrap(first));
+    cell->SetSecond(Unwrap(second));
+    return Wrap(ctx, cell);
+}
+
+// car and cdr repeat the builtins after the evaluation of the argument
+AotValue RuntimeCar(AotContext* ctx, AotValue value) {
+    auto& obj = Unwrap(value);
+    if (!obj) {
+        throw RuntimeError("smth is wrong");
+    }
+    return Wrap(ctx, Is<Cell>(obj) ? As<Cell>(obj)->GetFirst() : obj);
+}
+
+AotValue RuntimeCdr(AotContext* ctx, AotValue value) {
+    auto& obj = Unwrap(value);
+    if (!obj) {
+        throw RuntimeError("smth is wrong");
+    }
+    if (!Is<Cell>(obj)) {
+        throw RuntimeError("too few args");
+    }
+    return Wrap(ctx, As<Cell>(obj)->GetSecond());
+}
+
+AotValue RuntimeApply(AotContext* ctx, size_t builtin, size_t argc, const AotValue* argv) {
+    ConsumeEvalFuel();
+    std::vector<std::shared_ptr<Object>> values;
+    for (size_t i = 0; i < argc; ++i) {
+        values.push_back(Unwrap(argv[i]));
+    }
+    return Wrap(ctx, (*ctx->builtins)[builtin]->Apply(MakeArgs(values)));
+}
+
+void RuntimeFail(AotContext*, const char* message) {
+    throw RuntimeError(message);
+}
+
+const AotRuntime kRuntime = {
+    RuntimeNumber,   RuntimeBoolean,     RuntimeConstant, RuntimeEval,
+    RuntimeIsNumber, RuntimeNumberValue, RuntimeIsFalse,  RuntimeCons,
+    RuntimeCar,      RuntimeCdr,         RuntimeApply,    RuntimeFail};
+
+}  // namespace
+
+std::string CompileToCpp(const std::vector<AotSource>& sources) {
+    std::string out = "// generated by scheme_aot\n\n#include \"aot_runtime.h\"\n\n";
+    std::string entries;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        EntryCompiler compiler{sources[i].expr};
+        out += compiler.Compile("entry_" + std::to_string(i), sources[i].name);
+        entries += "    " + compiler.GetEntry() + ",\n";
+    }
+    out += "extern \"C\" {\n\n";
+    out += "extern const int scheme_aot_abi_version = " + std::to_string(kAotAbiVersion) + ";\n";
+    out += "extern const AotEntry scheme_aot_entries[] = {\n" + entries + "};\n";
+    out += "extern const size_t scheme_aot_entry_count = " + std::to_string(sources.size()) +
+           ";\n\n}\n";
+    return out;
+}
+
+AotModule::AotModule(const std::string& path) {
+    handle_ = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle_) {
+        throw std::runtime_error(std::string("cannot load ") + path + ": " + dlerror());
+    }
+    auto version = static_cast<const int*>(dlsym(handle_, "scheme_aot_abi_version"));
+    auto code = static_cast<const AotEntry*>(dlsym(handle_, "scheme_aot_entries"));
+    auto count = static_cast<const size_t*>(dlsym(handle_, "scheme_aot_entry_count"));
+    if (!version || !code || !count || *version != kAotAbiVersion) {
+        dlclose(handle_);
+        throw std::runtime_error(path + " is not a compiled scheme module of this version");
+    }
+
+    try {
+        // builtins are looked up without user definitions
+        EnvironmentScope env_scope{nullptr};
+        for (size_t i = 0; i < *count; ++i) {
+            Entry entry{code[i].name, &code[i], {}, {}, {}};
+            for (size_t j = 0; j < code[i].constant_count; ++j) {
+                entry.constants.push_back(ReadFullString(
+                    std::string(code[i].constants[j], code[i].constant_sizes[j])));
+            }
+            for (size_t j = 0; j < code[i].builtin_count; ++j) {
+                if (!FindBuiltin(code[i].builtins[j])) {
+                    throw std::runtime_error(std::string("unknown builtin ") +
+                                             code[i].builtins[j]);
+                }
+                auto symbol = std::make_shared<Symbol>(SymbolToken{code[i].builtins[j]});
+                entry.builtin_names.push_back(symbol->GetInternedName());
+                entry.builtins.push_back(symbol->Eval());
+            }
+            entries_.push_back(std::move(entry));
+        }
+    } catch (...) {
+        entries_.clear();
+        dlclose(handle_);
+        throw;
+    }
+}
+
+AotModule::~AotModule() {
+    // the objects made from the module don't refer to its code, so it may go
+    entries_.clear();
+    dlclose(handle_);
+}
+
+std::shared_ptr<Object> AotModule::Eval(size_t index) const {
+    auto& entry = entries_.at(index);
+    if (auto env = Environment::GetCurrent()) {
+        for (auto name : entry.builtin_names) {
+            if (env->Find(name)) {
+                return entry.constants[0]->Eval();
+            }
+        }
+    }
+    AotContext ctx{{}, &entry.constants, &entry.builtins};
+    return Unwrap(entry.code->run(&ctx, &kRuntime));
+}
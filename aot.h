@@ -0,0 +1,57 @@
+#pragma once
+
+#include "aot_runtime.h"
+#include "object.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// ahead-of-time compilation of expressions to C++.
+//
+// numbers and booleans that the compiler can follow stay unboxed: arithmetic and
+// comparisons on them become plain C++ operations, and car, cdr and cons become direct
+// calls into the runtime. the other builtins that evaluate all their arguments are called
+// with the evaluated values; special forms and anything unusual are left to the
+// interpreter, so a compiled expression gives the same result as an interpreted one
+
+struct AotSource {
+    std::string name;
+    std::shared_ptr<Object> expr;
+};
+
+// a C++ translation unit with an entry per expression, to be built as a shared library
+// with aot_runtime.h on the include path
+std::string CompileToCpp(const std::vector<AotSource>& sources);
+
+// a library built from the output of CompileToCpp
+class AotModule {
+public:
+    // throws std::runtime_error when the library can't be loaded
+    explicit AotModule(const std::string& path);
+    ~AotModule();
+
+    AotModule(const AotModule&) = delete;
+    AotModule& operator=(const AotModule&) = delete;
+
+    size_t GetEntryCount() const {
+        return entries_.size();
+    }
+    const std::string& GetEntryName(size_t entry) const {
+        return entries_[entry].name;
+    }
+    // evaluates the entry in the current environment, see Interpreter::RunCompiled
+    std::shared_ptr<Object> Eval(size_t entry) const;
+
+private:
+    struct Entry {
+        std::string name;
+        const AotEntry* code;
+        std::vector<std::shared_ptr<Object>> constants;
+        std::vector<const std::string*> builtin_names;
+        std::vector<std::shared_ptr<Object>> builtins;
+    };
+
+    void* handle_ = nullptr;
+    std::vector<Entry> entries_;
+};
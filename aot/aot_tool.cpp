@@ -0,0 +1,152 @@
+// ahead-of-time compiler: turns a file with an expression per line into C++ and, with
+// --so, into a shared library for AotModule. --check runs every expression both
+// interpreted and compiled and reports the ones whose results differ
+//
+// usage: scheme_aot INPUT -o OUTPUT.cpp [--so OUTPUT.so] [--check] [--repeat N] [--cxx COMPILER]
+
+#include "aot.h"
+#include "scheme.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Line {
+    size_t number;
+    std::string text;
+};
+
+std::vector<Line> ReadLines(const std::string& path) {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::vector<Line> lines;
+    std::string text;
+    for (size_t number = 1; std::getline(in, text); ++number) {
+        auto start = text.find_first_not_of(" \t\r");
+        if (start == std::string::npos || text[start] == ';') {
+            continue;
+        }
+        lines.push_back({number, text});
+    }
+    return lines;
+}
+
+// the result or the error, as printed by the server
+std::string Outcome(const std::function<std::string()>& run) {
+    try {
+        return "ok " + run();
+    } catch (const SyntaxError& error) {
+        return std::string("syntax error: ") + error.what();
+    } catch (const NameError& error) {
+        return std::string("name error: ") + error.what();
+    } catch (const RuntimeError& error) {
+        return std::string("runtime error: ") + error.what();
+    }
+}
+
+double Seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+int Check(const std::vector<Line>& lines, const AotModule& module, size_t repeat) {
+    // both sides run the lines in order, so that definitions are seen by the later lines
+    Interpreter interpreted;
+    Interpreter compiled;
+    std::chrono::steady_clock::duration interpreted_time{};
+    std::chrono::steady_clock::duration compiled_time{};
+    size_t mismatches = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        auto text = lines[i].text;
+        std::string expected;
+        std::string actual;
+        for (size_t r = 0; r < repeat; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            expected = Outcome([&] { return interpreted.Run(text); });
+            auto middle = std::chrono::steady_clock::now();
+            actual = Outcome([&] { return compiled.RunCompiled(module, i); });
+            compiled_time += std::chrono::steady_clock::now() - middle;
+            interpreted_time += middle - start;
+        }
+        if (expected != actual) {
+            ++mismatches;
+            std::printf("line %zu: %s\n  interpreted: %s\n  compiled:    %s\n", lines[i].number,
+                        text.c_str(), expected.c_str(), actual.c_str());
+        }
+    }
+    std::printf("%zu expressions, %zu mismatches; interpreted %.3f ms, compiled %.3f ms\n",
+                lines.size(), mismatches, Seconds(interpreted_time) * 1e3,
+                Seconds(compiled_time) * 1e3);
+    return mismatches ? 1 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string input;
+    std::string output;
+    std::string library;
+    std::string cxx = SCHEME_AOT_CXX;
+    bool check = false;
+    size_t repeat = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--so" && i + 1 < argc) {
+            library = argv[++i];
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(std::stoul(argv[++i]), 1ul);
+        } else if (arg == "--cxx" && i + 1 < argc) {
+            cxx = argv[++i];
+        } else if (input.empty() && arg[0] != '-') {
+            input = arg;
+        } else {
+            input.clear();
+            break;
+        }
+    }
+    if (input.empty() || output.empty() || (check && library.empty())) {
+        std::fprintf(stderr,
+                     "usage: %s INPUT -o OUTPUT.cpp [--so OUTPUT.so] [--check] [--repeat N] "
+                     "[--cxx COMPILER]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    try {
+        auto lines = ReadLines(input);
+        std::vector<AotSource> sources;
+        for (auto& line : lines) {
+            sources.push_back(
+                {input + ":" + std::to_string(line.number), ReadFullString(line.text)});
+        }
+        std::ofstream{output} << CompileToCpp(sources);
+        if (library.empty()) {
+            return 0;
+        }
+
+        std::string command = cxx + " -std=c++17 -O2 -shared -fPIC -I" SCHEME_AOT_INCLUDE_DIR " " +
+                              output + " -o " + library;
+        if (std::system(command.c_str()) != 0) {
+            std::fprintf(stderr, "failed: %s\n", command.c_str());
+            return 1;
+        }
+        if (check) {
+            AotModule module{library};
+            return Check(lines, module, repeat);
+        }
+    } catch (const std::exception& error) {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+}
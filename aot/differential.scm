@@ -0,0 +1,102 @@
+; expressions for scheme_aot --check, one per line. the lines run in order on both
+; sides, so definitions reach the lines below them
+(+ 1 2 3)
+(+)
+(*)
+(- 10 3 2)
+(- 5)
+(/ 100 7 2)
+(/ 1 0)
+(/ 7)
+(max 3 9 -2)
+(min 3 9 -2)
+(max)
+(abs -42)
+(abs 1 2)
+(* 2147483647 2147483647 2 2 2)
+(+ (* 2147483647 2147483647 2) (* 2147483647 2147483647 2))
+(= 1 1 1)
+(= 1 2)
+(< 1 2 3)
+(< 1 3 2)
+(> 3 2 1)
+(<= 1 1 2)
+(>= 2 2 3)
+(<)
+(< 1)
+(+ 1 #t)
+(< 1 #f)
+(+ 1 (quote a))
+(+ (* 2 3) (- 10 (abs -4)) (max 1 (min 8 5)))
+(< (+ 1 2) (* 2 2) (- 10 1))
+(define x 10)
+(define y -3)
+(+ x y 1)
+(* x (abs y) (max x y))
+(< y 0 x)
+(/ x 0)
+(define v (make-vector 5 7))
+(+ v)
+(max v)
+(vector-sum (vector-add v v))
+(vector-ref (vector 1 2 3) (+ 1 1))
+(and)
+(or)
+(and 1 2 3)
+(and 1 #f 3)
+(or #f #f)
+(or #f (+ 1 2) (/ 1 0))
+(and (< 1 2) (> 1 2))
+(and (< 1 2) (+ 40 2))
+(cons 1 2)
+(cons 1 (cons 2 (quote ())))
+(cons 1)
+(cons)
+(car (quote (1 2 3)))
+(cdr (quote (1 2 3)))
+(car (list (+ 1 2) 4))
+(cdr (cons 1 2))
+(car (quote ()))
+(cdr (+ 1 2))
+(car (+ 1 2))
+(car x)
+(car (quote (1 2)) (/ 1 0))
+(list 1 (+ 1 1) (quote (a b)) #t)
+(list-ref (list 1 2 3) (- 3 1))
+(list-tail (list 1 2 3) 1)
+(list-ref (list 1 2 3) 5)
+(pair? (cons 1 2))
+(null? (quote ()))
+(list? (list 1 2))
+(quote (1 (2 3) . 4))
+(quote x)
+(quote 5)
+(not #f)
+(not (< 1 2))
+(boolean? (< 1 2))
+(number? (+ 1 2))
+(number? 5)
+(sort < (list 3 1 2))
+(par-map abs (list -1 2 -3))
+(par-reduce + (vector 1 2 3 4))
+(hash-table-count (hash-table-set! (make-hash-table) (quote a) (+ 1 2)))
+(hash-table-ref (hash-table-set! (make-hash-table) 1 2) 1)
+(stream-take (cons-stream 1 (cons-stream 2 (quote ()))) 2)
+(force (delay (+ 1 2)))
+(define + -)
+(+ 10 3)
+(* (+ 10 3) 2)
+(define car cdr)
+(car (quote (1 2)))
+(undefined-function 1 2)
+undefined-variable
+(+ 1 undefined-variable)
+x
+(x)
+(string-length (string-append "abc" "defghijklmnopqrstuvwxyz"))
+(substring (string-append "a long string " "that is not inline") 2 (+ 10 10))
+(string-ref (substring "hello, world" 7) 0)
+(string->symbol (string-append "vec" "tor"))
+(list "quoted \"text\"\n" #\space #\a (string-length ""))
+(string-ref "abc" (+ 1 5))
+(list (string-length "cr\rnul\x0;tab\tdel\x7f;é") (substring "cr\rnul\x00;end" 1 7) "\x1;\x0;2")
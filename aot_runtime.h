@@ -0,0 +1,76 @@
+#pragma once
+
+// the interface between the interpreter and the code generated by the ahead-of-time
+// compiler (see aot.h). the generated code includes nothing else, it reaches the
+// interpreter only through the table of functions below, so it doesn't depend on the
+// layout of the interpreter classes
+
+#include <cstddef>
+#include <cstdint>
+
+// a value owned by the interpreter, valid until the end of the call of the entry
+struct AotObject;
+using AotValue = const AotObject*;
+struct AotContext;
+
+struct AotRuntime {
+    AotValue (*number)(AotContext* ctx, int64_t value);
+    AotValue (*boolean)(AotContext* ctx, bool value);
+    // the constants of the entry, e.g. quoted data
+    AotValue (*constant)(AotContext* ctx, size_t index);
+    // evaluates a constant with the interpreter: symbols and unsupported forms
+    AotValue (*eval)(AotContext* ctx, size_t index);
+
+    bool (*is_number)(AotValue value);
+    int64_t (*number_value)(AotValue value);
+    // only #f is false
+    bool (*is_false)(AotValue value);
+
+    AotValue (*cons)(AotContext* ctx, AotValue first, AotValue second);
+    AotValue (*car)(AotContext* ctx, AotValue value);
+    AotValue (*cdr)(AotContext* ctx, AotValue value);
+    // applies a builtin of the entry to evaluated arguments
+    AotValue (*apply)(AotContext* ctx, size_t builtin, size_t argc, const AotValue* argv);
+    // throws a RuntimeError
+    void (*fail)(AotContext* ctx, const char* message);
+};
+
+struct AotEntry {
+    const char* name;
+    AotValue (*run)(AotContext* ctx, const AotRuntime* rt);
+    // scheme source of the constants, the first one is the whole expression. the sizes
+    // are given, as quoted strings may hold null bytes
+    const char* const* constants;
+    const size_t* constant_sizes;
+    size_t constant_count;
+    // builtins the code relies on. the whole expression is interpreted instead when
+    // one of them is redefined in the environment of the call
+    const char* const* builtins;
+    size_t builtin_count;
+};
+
+// the generated library exports
+//   extern "C" const int scheme_aot_abi_version;
+//   extern "C" const AotEntry scheme_aot_entries[];
+//   extern "C" const size_t scheme_aot_entry_count;
+constexpr int kAotAbiVersion = 2;
+
+// integer arithmetic wraps around, as it does in the interpreter
+inline int64_t AotAdd(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+inline int64_t AotSub(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+inline int64_t AotMul(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+inline int64_t AotAbs(int64_t a) {
+    return a < 0 ? AotSub(0, a) : a;
+}
+inline int64_t AotMax(int64_t a, int64_t b) {
+    return a < b ? b : a;
+}
+inline int64_t AotMin(int64_t a, int64_t b) {
+    return b < a ? b : a;
+}
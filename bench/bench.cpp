@@ -0,0 +1,273 @@
+// benchmark of the interpreter phases on generated workloads
+//
+// every workload is measured phase by phase: tokenizing, parsing, evaluating the
+// parsed tree, printing the result, and the whole Interpreter::Run. the results are
+// printed as a table or, with --json, as a json document meant to be stored and
+// compared between commits
+//
+// usage: scheme_bench [--json] [--scale N] [--min-time SECONDS] [--filter SUBSTRING]
+
+#include "scheme.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::atomic<uint64_t> allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+struct Workload {
+    std::string name;
+    std::string expr;
+};
+
+struct Measurement {
+    double ns_per_op = 0;
+    double allocations_per_op = 0;
+};
+
+struct Result {
+    std::string name;
+    size_t bytes = 0;
+    size_t tokens = 0;
+    size_t nodes = 0;
+    Measurement tokenize;
+    Measurement parse;
+    Measurement eval;
+    Measurement print;
+    Measurement run;
+};
+
+std::string Numbers(size_t cnt) {
+    std::string s;
+    for (size_t i = 0; i < cnt; ++i) {
+        s += ' ' + std::to_string(i);
+    }
+    return s;
+}
+
+std::vector<Workload> MakeWorkloads(size_t scale) {
+    std::vector<Workload> workloads;
+
+    // deeper expressions are rejected by the parser
+    size_t depth = std::min<size_t>(200 * scale, kMaxNestingDepth - 1);
+    std::string nested;
+    for (size_t i = 0; i < depth; ++i) {
+        nested += "(+ 1 ";
+    }
+    nested += "0" + std::string(depth, ')');
+    workloads.push_back({"deep_nesting", nested});
+
+    size_t length = 1000 * scale;
+    workloads.push_back({"flat_list", "(list" + Numbers(length) + ")"});
+    workloads.push_back({"quoted_list", "'(" + Numbers(length) + ")"});
+
+    std::string arithmetic = "(+";
+    for (size_t i = 1; i <= 250 * scale; ++i) {
+        auto n = std::to_string(i);
+        arithmetic += " (* " + n + " 3) (- " + n + " 7) (/ 1000 " + n + ") (max " + n + " 5)";
+    }
+    arithmetic += ")";
+    workloads.push_back({"arithmetic", arithmetic});
+
+    std::string chain = "(and";
+    for (size_t i = 0; i < 250 * scale; ++i) {
+        chain += " (or #f (not #f)) (boolean? #t) (and #t (< 1 2))";
+    }
+    chain += ")";
+    workloads.push_back({"boolean_chain", chain});
+
+    auto list = "'(" + Numbers(length) + ")";
+    workloads.push_back(
+        {"list_ref", "(list-ref " + list + " " + std::to_string(length - 1) + ")"});
+    workloads.push_back(
+        {"list_tail", "(list-tail " + list + " " + std::to_string(length / 2) + ")"});
+
+    return workloads;
+}
+
+size_t CountTokens(const std::string& expr) {
+    std::stringstream ss{expr};
+    Tokenizer tokenizer{&ss};
+    size_t cnt = 0;
+    while (!tokenizer.IsEnd()) {
+        tokenizer.GetToken();
+        tokenizer.Next();
+        ++cnt;
+    }
+    return cnt;
+}
+
+size_t CountNodes(const std::shared_ptr<Object>& root) {
+    size_t cnt = 0;
+    std::vector<std::shared_ptr<Object>> stack{root};
+    while (!stack.empty()) {
+        auto cur = stack.back();
+        stack.pop_back();
+        if (!cur) {
+            continue;
+        }
+        ++cnt;
+        if (Is<Cell>(cur)) {
+            stack.push_back(As<Cell>(cur)->GetFirst());
+            stack.push_back(As<Cell>(cur)->GetSecond());
+        }
+    }
+    return cnt;
+}
+
+// repeats op until min_time has passed, at least once
+template <class F>
+Measurement Measure(double min_time, F&& op) {
+    using Clock = std::chrono::steady_clock;
+    op();  // warm up
+
+    size_t ops = 0;
+    uint64_t start_allocations = allocations.load(std::memory_order_relaxed);
+    auto start = Clock::now();
+    std::chrono::duration<double> elapsed{};
+    do {
+        op();
+        ++ops;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < min_time);
+    uint64_t total_allocations = allocations.load(std::memory_order_relaxed) - start_allocations;
+
+    Measurement res;
+    res.ns_per_op = elapsed.count() * 1e9 / ops;
+    res.allocations_per_op = static_cast<double>(total_allocations) / ops;
+    return res;
+}
+
+Result Run(const Workload& workload, double min_time) {
+    Result res;
+    res.name = workload.name;
+    res.bytes = workload.expr.size();
+    res.tokens = CountTokens(workload.expr);
+
+    res.tokenize = Measure(min_time, [&] { CountTokens(workload.expr); });
+
+    std::shared_ptr<Object> tree;
+    res.parse = Measure(min_time, [&] { tree = ReadFullString(workload.expr); });
+    res.nodes = CountNodes(tree);
+
+    std::shared_ptr<Object> value;
+    res.eval = Measure(min_time, [&] { value = tree->Eval(); });
+
+    std::string printed;
+    res.print = Measure(min_time, [&] { printed = RepresentAsStr(value); });
+
+    Interpreter interpreter;
+    auto expr = workload.expr;
+    res.run = Measure(min_time, [&] { interpreter.Run(expr); });
+    return res;
+}
+
+double PerSecond(double units, const Measurement& m) {
+    return units * 1e9 / m.ns_per_op;
+}
+
+void PrintTable(const std::vector<Result>& results) {
+    std::printf("%-14s %12s %12s %12s %11s %11s %11s %11s\n", "workload", "tokens/s",
+                "nodes/s", "evals/s", "print ns", "run ns", "eval alloc", "run alloc");
+    for (auto& r : results) {
+        std::printf("%-14s %12.4g %12.4g %12.4g %11.0f %11.0f %11.1f %11.1f\n", r.name.c_str(),
+                    PerSecond(r.tokens, r.tokenize), PerSecond(r.nodes, r.parse),
+                    PerSecond(1, r.eval), r.print.ns_per_op, r.run.ns_per_op,
+                    r.eval.allocations_per_op, r.run.allocations_per_op);
+    }
+}
+
+void PrintPhase(const char* name, const Measurement& m, bool last) {
+    std::printf("        \"%s\": {\"ns_per_op\": %.1f, \"allocations_per_op\": %.2f}%s\n", name,
+                m.ns_per_op, m.allocations_per_op, last ? "" : ",");
+}
+
+void PrintJson(const std::vector<Result>& results, size_t scale, double min_time) {
+    std::printf("{\n  \"version\": 1,\n  \"scale\": %zu,\n  \"min_time\": %g,\n", scale,
+                min_time);
+    std::printf("  \"workloads\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& r = results[i];
+        std::printf("    {\n      \"name\": \"%s\",\n", r.name.c_str());
+        std::printf("      \"bytes\": %zu,\n      \"tokens\": %zu,\n      \"nodes\": %zu,\n",
+                    r.bytes, r.tokens, r.nodes);
+        std::printf("      \"tokens_per_sec\": %.1f,\n", PerSecond(r.tokens, r.tokenize));
+        std::printf("      \"nodes_per_sec\": %.1f,\n", PerSecond(r.nodes, r.parse));
+        std::printf("      \"evals_per_sec\": %.1f,\n", PerSecond(1, r.eval));
+        std::printf("      \"phases\": {\n");
+        PrintPhase("tokenize", r.tokenize, false);
+        PrintPhase("parse", r.parse, false);
+        PrintPhase("eval", r.eval, false);
+        PrintPhase("print", r.print, false);
+        PrintPhase("run", r.run, true);
+        std::printf("      }\n    }%s\n", i + 1 == results.size() ? "" : ",");
+    }
+    std::printf("  ]\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool json = false;
+    size_t scale = 1;
+    double min_time = 0.2;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--scale" && i + 1 < argc) {
+            scale = std::stoul(argv[++i]);
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            min_time = std::stod(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--json] [--scale N] [--min-time SECONDS] "
+                         "[--filter SUBSTRING]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    for (auto& workload : MakeWorkloads(scale)) {
+        if (workload.name.find(filter) != std::string::npos) {
+            results.push_back(Run(workload, min_time));
+        }
+    }
+
+    if (json) {
+        PrintJson(results, scale, min_time);
+    } else {
+        PrintTable(results);
+    }
+}
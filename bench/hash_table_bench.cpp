@@ -0,0 +1,109 @@
+// compares hash table lookups with the association list scan,
+// which is what lookups in scheme code over car/cdr amount to
+//
+// usage: hash_table_bench [max_size]
+
+#include "hash_table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace {
+
+std::shared_ptr<Object> MakeKey(int64_t i, bool symbolic) {
+    if (symbolic) {
+        return std::make_shared<Symbol>(SymbolToken{"key-" + std::to_string(i)});
+    }
+    return std::make_shared<Number>(ConstantToken{i * 7919});
+}
+
+// ((key . value) ...), built front to back
+std::shared_ptr<Object> MakeAlist(const std::vector<std::shared_ptr<Object>>& keys) {
+    std::shared_ptr<Object> list;
+    for (size_t i = keys.size(); i-- > 0;) {
+        auto pair = std::make_shared<Cell>();
+        pair->SetFirst(keys[i]);
+        pair->SetSecond(std::make_shared<Number>(ConstantToken{static_cast<int64_t>(i)}));
+        auto cell = std::make_shared<Cell>();
+        cell->SetFirst(pair);
+        cell->SetSecond(list);
+        list = cell;
+    }
+    return list;
+}
+
+std::shared_ptr<Object> Assoc(const std::shared_ptr<Object>& alist,
+                              const std::shared_ptr<Object>& key) {
+    for (auto cur = alist; cur; cur = As<Cell>(cur)->GetSecond()) {
+        auto pair = As<Cell>(As<Cell>(cur)->GetFirst());
+        if (ObjectsEqual(pair->GetFirst(), key)) {
+            return pair->GetSecond();
+        }
+    }
+    return nullptr;
+}
+
+template <class F>
+double NanosPerOp(size_t ops, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+}
+
+void Run(size_t size, bool symbolic) {
+    std::vector<std::shared_ptr<Object>> keys;
+    for (size_t i = 0; i < size; ++i) {
+        keys.push_back(MakeKey(i, symbolic));
+    }
+    // probes are fresh objects, so that equality can't shortcut on identity
+    std::vector<std::shared_ptr<Object>> probes;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> dist(0, size - 1);
+    for (size_t i = 0; i < 4096; ++i) {
+        probes.push_back(MakeKey(dist(gen), symbolic));
+    }
+
+    HashTable table;
+    for (size_t i = 0; i < size; ++i) {
+        table.Insert(keys[i], std::make_shared<Number>(ConstantToken{static_cast<int64_t>(i)}));
+    }
+    auto alist = MakeAlist(keys);
+
+    // the scan is linear, so it gets fewer rounds on the larger sizes
+    size_t table_rounds = 64;
+    size_t alist_rounds = std::max<size_t>(1, 256 / size);
+    size_t found = 0;
+    double table_ns = NanosPerOp(table_rounds * probes.size(), [&] {
+        for (size_t r = 0; r < table_rounds; ++r) {
+            for (auto& probe : probes) {
+                found += table.Find(probe) != nullptr;
+            }
+        }
+    });
+    double alist_ns = NanosPerOp(alist_rounds * probes.size(), [&] {
+        for (size_t r = 0; r < alist_rounds; ++r) {
+            for (auto& probe : probes) {
+                found += Assoc(alist, probe) != nullptr;
+            }
+        }
+    });
+    std::printf("%-8s %8zu  hash-table %10.1f ns/lookup  alist %12.1f ns/lookup  x%.1f\n",
+                symbolic ? "symbol" : "number", size, table_ns, alist_ns, alist_ns / table_ns);
+    if (found != (table_rounds + alist_rounds) * probes.size()) {
+        std::printf("lookup mismatch\n");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t max_size = argc > 1 ? std::stoul(argv[1]) : 4096;
+    for (bool symbolic : {false, true}) {
+        for (size_t size = 4; size <= max_size; size *= 4) {
+            Run(size, symbolic);
+        }
+    }
+}
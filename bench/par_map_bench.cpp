@@ -0,0 +1,67 @@
+// speedup of par-map/par-reduce on numeric workloads at 1, 2, 4 and 8 threads
+//
+// usage: par_map_bench [size]
+
+#include "scheme.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+constexpr int kRepetitions = 5;
+
+struct Workload {
+    std::string name;
+    std::string expr;
+};
+
+double MedianSeconds(Interpreter& interpreter, std::string expr) {
+    std::vector<double> times;
+    for (int i = 0; i < kRepetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        interpreter.Run(expr);
+        times.push_back(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? std::stoul(argv[1]) : 200000;
+    auto n = std::to_string(size);
+
+    std::string rows = "(vector";
+    for (int i = 0; i < 64; ++i) {
+        rows += " (make-vector " + std::to_string(size / 64) + " " + std::to_string(i) + ")";
+    }
+    rows += ")";
+
+    std::vector<Workload> workloads = {
+        {"par-map abs", "(par-map abs (make-vector " + n + " -3))"},
+        {"par-reduce +", "(par-reduce + (make-vector " + n + " 3))"},
+        {"par-reduce max", "(par-reduce max 0 (par-map abs (make-vector " + n + " -7)))"},
+        {"par-map vector-sum", "(par-map vector-sum " + rows + ")"},
+    };
+
+    Interpreter interpreter;
+    std::printf("%-20s %8s %12s %8s\n", "workload", "threads", "ms", "speedup");
+    for (auto& workload : workloads) {
+        double base = 0;
+        for (size_t threads : {1, 2, 4, 8}) {
+            ThreadPool::SetGlobalThreadCount(threads);
+            double seconds = MedianSeconds(interpreter, workload.expr);
+            if (threads == 1) {
+                base = seconds;
+            }
+            std::printf("%-20s %8zu %12.2f %8.2f\n", workload.name.c_str(), threads,
+                        seconds * 1000, base / seconds);
+        }
+    }
+}
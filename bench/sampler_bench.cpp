@@ -0,0 +1,107 @@
+// overhead of the sampling profiler: every workload runs outside of a SampledRequest,
+// then inside of one with the sampler running. with --folded, the stacks sampled
+// meanwhile are written to the file, e.g. for flamegraph.pl
+//
+// usage: sampler_bench [--size N] [--folded FILE]
+
+#include "sampler.h"
+#include "scheme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kRepetitions = 5;
+
+struct Workload {
+    std::string name;
+    std::string expr;
+};
+
+double MedianSeconds(Interpreter& interpreter, std::string expr, bool sampled) {
+    std::vector<double> times;
+    for (int i = 0; i < kRepetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (sampled) {
+            SampledRequest request;
+            interpreter.Run(expr);
+        } else {
+            interpreter.Run(expr);
+        }
+        times.push_back(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// (+ (abs (- 0 1)) (abs (- 1 1)) ...), a few calls per term
+std::string Calls(size_t size) {
+    std::string expr = "(+";
+    for (size_t i = 0; i < size; ++i) {
+        expr += " (abs (- " + std::to_string(i) + " 1))";
+    }
+    return expr + ")";
+}
+
+// (+ 1 (+ 1 (+ 1 ...))), as deep as the reader allows
+std::string Nested(size_t size) {
+    size_t depth = std::min(size, kMaxNestingDepth - 1);
+    std::string expr;
+    for (size_t i = 0; i < depth; ++i) {
+        expr += "(+ 1 ";
+    }
+    expr += "0";
+    expr.append(depth, ')');
+    return expr;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t size = 100000;
+    std::string folded;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            size = std::stoul(argv[++i]);
+        } else if (arg == "--folded" && i + 1 < argc) {
+            folded = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--size N] [--folded FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Workload> workloads = {
+        {"calls", Calls(size)},
+        {"nested", Nested(size)},
+        {"vector", "(vector-sum (vector-add (make-vector " + std::to_string(size) +
+                       " 1) (make-vector " + std::to_string(size) + " 2)))"},
+    };
+
+    Interpreter interpreter;
+    SamplingProfiler::Start();
+    std::printf("%-12s %12s %12s %10s\n", "workload", "off ms", "sampled ms", "overhead");
+    for (auto& workload : workloads) {
+        double off = MedianSeconds(interpreter, workload.expr, false);
+        double sampled = MedianSeconds(interpreter, workload.expr, true);
+        std::printf("%-12s %12.2f %12.2f %9.1f%%\n", workload.name.c_str(), off * 1000,
+                    sampled * 1000, (sampled / off - 1) * 100);
+    }
+    SamplingProfiler::Stop();
+
+    if (!folded.empty()) {
+        std::ofstream out{folded};
+        SamplingProfiler::WriteFolded(out);
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", folded.c_str());
+            return 1;
+        }
+    }
+}
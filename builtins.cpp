@@ -0,0 +1,203 @@
+#include "builtins.h"
+#include "object.h"
+#include "hash_table.h"
+#include "parallel.h"
+#include "sort.h"
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+
+namespace {
+
+// constant-initialized, as the constructor of Func is constexpr. kept in one object,
+// so that a single destructor is registered to run at exit
+std::tuple<IsBool,
+           Not,
+           And,
+           Or,
+           Quote,
+           Define,
+           IsPair,
+           IsNull,
+           IsList,
+           Cons,
+           Car,
+           Cdr,
+           List,
+           ListRef,
+           ListTail,
+           IsNumber,
+           IsEqual,
+           IsDecrease,
+           IsIncrease,
+           IsNonIncrease,
+           IsNonDecrease,
+           Sum,
+           Sub,
+           Prod,
+           Div,
+           Max,
+           Min,
+           Abs,
+           MakeVector,
+           VectorLiteral,
+           VectorRef,
+           VectorSet,
+           VectorLength,
+           VectorSum,
+           VectorMin,
+           VectorMax,
+           VectorAdd,
+           VectorMul,
+           VectorDot,
+           StringLength,
+           StringRef,
+           Substring,
+           StringAppend,
+           StringToSymbol,
+           MakeHashTable,
+           HashTableRef,
+           HashTableSet,
+           HashTableDelete,
+           HashTableCount,
+           ParMap,
+           ParReduce,
+           Sort,
+           Delay,
+           Force,
+           ConsStream,
+           StreamCar,
+           StreamCdr,
+           StreamTake,
+           StreamMap,
+           StreamFilter,
+           ProfileReport,
+           MemoryStatsReport>
+    instances;
+
+template <class T>
+constexpr Func* Get() {
+    return &std::get<T>(instances);
+}
+
+struct Builtin {
+    std::string_view name;
+    Func* func;
+};
+
+constexpr Builtin kBuiltins[] = {
+    {"boolean?", Get<IsBool>()},
+    {"not", Get<Not>()},
+    {"and", Get<And>()},
+    {"or", Get<Or>()},
+    {"quote", Get<Quote>()},
+    {"define", Get<Define>()},
+    {"pair?", Get<IsPair>()},
+    {"null?", Get<IsNull>()},
+    {"list?", Get<IsList>()},
+    {"cons", Get<Cons>()},
+    {"car", Get<Car>()},
+    {"cdr", Get<Cdr>()},
+    {"list", Get<List>()},
+    {"list-ref", Get<ListRef>()},
+    {"list-tail", Get<ListTail>()},
+    {"number?", Get<IsNumber>()},
+    {"=", Get<IsEqual>()},
+    {">", Get<IsDecrease>()},
+    {"<", Get<IsIncrease>()},
+    {">=", Get<IsNonIncrease>()},
+    {"<=", Get<IsNonDecrease>()},
+    {"+", Get<Sum>()},
+    {"-", Get<Sub>()},
+    {"*", Get<Prod>()},
+    {"/", Get<Div>()},
+    {"max", Get<Max>()},
+    {"min", Get<Min>()},
+    {"abs", Get<Abs>()},
+    {"make-vector", Get<MakeVector>()},
+    {"vector", Get<VectorLiteral>()},
+    {"vector-ref", Get<VectorRef>()},
+    {"vector-set!", Get<VectorSet>()},
+    {"vector-length", Get<VectorLength>()},
+    {"vector-sum", Get<VectorSum>()},
+    {"vector-min", Get<VectorMin>()},
+    {"vector-max", Get<VectorMax>()},
+    {"vector-add", Get<VectorAdd>()},
+    {"vector-mul", Get<VectorMul>()},
+    {"vector-dot", Get<VectorDot>()},
+    {"string-length", Get<StringLength>()},
+    {"string-ref", Get<StringRef>()},
+    {"substring", Get<Substring>()},
+    {"string-append", Get<StringAppend>()},
+    {"string->symbol", Get<StringToSymbol>()},
+    {"make-hash-table", Get<MakeHashTable>()},
+    {"hash-table-ref", Get<HashTableRef>()},
+    {"hash-table-set!", Get<HashTableSet>()},
+    {"hash-table-delete!", Get<HashTableDelete>()},
+    {"hash-table-count", Get<HashTableCount>()},
+    {"par-map", Get<ParMap>()},
+    {"par-reduce", Get<ParReduce>()},
+    {"sort", Get<Sort>()},
+    {"delay", Get<Delay>()},
+    {"force", Get<Force>()},
+    {"cons-stream", Get<ConsStream>()},
+    {"stream-car", Get<StreamCar>()},
+    {"stream-cdr", Get<StreamCdr>()},
+    {"stream-take", Get<StreamTake>()},
+    {"stream-map", Get<StreamMap>()},
+    {"stream-filter", Get<StreamFilter>()},
+    {"profile-report", Get<ProfileReport>()},
+    {"memory-stats", Get<MemoryStatsReport>()}};
+
+constexpr size_t kTableSize = 512;
+constexpr uint8_t kEmptySlot = 0xff;
+static_assert(std::size(kBuiltins) < kEmptySlot);
+
+constexpr uint64_t HashName(std::string_view name, uint64_t seed) {
+    // fnv-1a, with the high bits folded in, as its low bits are weak on short names
+    uint64_t hash = 0xcbf29ce484222325ull ^ (seed * 0x9e3779b97f4a7c15ull);
+    for (char ch : name) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 0x100000001b3ull;
+    }
+    return hash ^ (hash >> 29);
+}
+
+struct PerfectHash {
+    uint64_t seed;
+    std::array<uint8_t, kTableSize> slots;
+};
+
+// tries seeds until the names land in distinct slots. at this load a seed works with
+// a probability of a few percent, so it takes some dozens of attempts, all at compile time
+constexpr PerfectHash BuildPerfectHash() {
+    for (uint64_t seed = 1;; ++seed) {
+        PerfectHash table{seed, {}};
+        for (auto& slot : table.slots) {
+            slot = kEmptySlot;
+        }
+        bool collision = false;
+        for (size_t i = 0; i < std::size(kBuiltins) && !collision; ++i) {
+            auto& slot = table.slots[HashName(kBuiltins[i].name, seed) & (kTableSize - 1)];
+            collision = slot != kEmptySlot;
+            slot = i;
+        }
+        if (!collision) {
+            return table;
+        }
+    }
+}
+
+constexpr PerfectHash kTable = BuildPerfectHash();
+
+}  // namespace
+
+Func* FindBuiltin(std::string_view name) {
+    auto slot = kTable.slots[HashName(name, kTable.seed) & (kTableSize - 1)];
+    if (slot == kEmptySlot || kBuiltins[slot].name != name) {
+        return nullptr;
+    }
+    return kBuiltins[slot].func;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string_view>
+
+class Func;
+
+// the builtin with the given name, nullptr when there is none. the table is a perfect
+// hash built at compile time over statically allocated functions, so nothing is
+// allocated at startup and a lookup hashes the name once and compares it once
+Func* FindBuiltin(std::string_view name);
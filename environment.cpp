@@ -0,0 +1,57 @@
+#include "environment.h"
+#include "object.h"
+
+#include <utility>
+
+namespace {
+
+thread_local Environment* current_env = nullptr;
+
+}  // namespace
+
+Environment::Environment(std::shared_ptr<const Environment> parent)
+    : parent_(std::move(parent)) {
+}
+
+const std::shared_ptr<Object>* Environment::Find(const std::string* name) const {
+    for (auto env = this; env; env = env->parent_.get()) {
+        auto it = env->bindings_.find(name);
+        if (it != env->bindings_.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void Environment::Define(const std::string* name, std::shared_ptr<Object> value) {
+    bindings_[name] = std::move(value);
+}
+
+std::shared_ptr<const Environment> Environment::Freeze() {
+    if (bindings_.empty()) {
+        return parent_;
+    }
+    auto frozen = std::make_shared<Environment>(parent_);
+    frozen->bindings_ = std::move(bindings_);
+    bindings_.clear();
+    // the forks share the values too, so whatever they could change is frozen
+    for (auto& [name, value] : frozen->bindings_) {
+        FreezeReachable(value);
+    }
+    // the nearer bindings win, so the ancestors only add what is missing
+    while (frozen->parent_ && frozen->parent_->bindings_.size() <= 2 * frozen->bindings_.size()) {
+        auto& absorbed = frozen->parent_->bindings_;
+        frozen->bindings_.insert(absorbed.begin(), absorbed.end());
+        frozen->parent_ = frozen->parent_->parent_;
+    }
+    parent_ = frozen;
+    return frozen;
+}
+
+Environment* Environment::GetCurrent() {
+    return current_env;
+}
+
+Environment* Environment::Exchange(Environment* env) {
+    return std::exchange(current_env, env);
+}
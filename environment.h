@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class Object;
+
+// user definitions of an interpreter, on top of the builtins of Symbol.
+//
+// an environment is a map of its own bindings over a frozen parent. frozen
+// environments are never modified, so any number of interpreters, also on different
+// threads, may share one as their parent and still keep their own writes local: a fork
+// costs one allocation, whatever the size of the environment behind it
+class Environment {
+public:
+    explicit Environment(std::shared_ptr<const Environment> parent = nullptr);
+
+    // keys are interned names, see Symbol::GetInternedName
+    const std::shared_ptr<Object>* Find(const std::string* name) const;
+    void Define(const std::string* name, std::shared_ptr<Object> value);
+
+    // moves the own bindings into a new frozen environment and continues as its child.
+    // the vectors, hash tables and promises reachable from them are frozen as well, see
+    // FreezeReachable. the new environment absorbs the ancestors up to twice its size,
+    // so the sizes along a chain more than double and lookups walk a logarithmic number
+    // of maps
+    std::shared_ptr<const Environment> Freeze();
+
+    // the environment of the evaluation on this thread, nullptr outside of one
+    static Environment* GetCurrent();
+    static Environment* Exchange(Environment* env);
+
+private:
+    std::shared_ptr<const Environment> parent_;
+    std::unordered_map<const std::string*, std::shared_ptr<Object>> bindings_;
+};
+
+// makes env current for the scope
+class EnvironmentScope {
+public:
+    explicit EnvironmentScope(Environment* env) : prev_(Environment::Exchange(env)) {
+    }
+    ~EnvironmentScope() {
+        Environment::Exchange(prev_);
+    }
+
+    EnvironmentScope(const EnvironmentScope&) = delete;
+    EnvironmentScope& operator=(const EnvironmentScope&) = delete;
+
+private:
+    Environment* prev_;
+};
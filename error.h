@@ -1,15 +1,132 @@
 #pragma once
 
+#include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
 
-struct SyntaxError : public std::runtime_error {
-    using std::runtime_error::runtime_error;
+// position of a token or of a parsed expression in the source. lines and columns
+// count from 1, length is in characters; a span of line 0 is unknown
+struct SourceSpan {
+    uint32_t line = 0;
+    uint16_t column = 0;
+    uint16_t length = 0;
+
+    bool IsKnown() const {
+        return line != 0;
+    }
+    // e.g. "3:14"
+    std::string ToString() const {
+        return std::to_string(line) + ":" + std::to_string(column);
+    }
 };
 
-struct RuntimeError : public std::runtime_error {
+// base of the errors of the interpreter, the span is filled in by the innermost
+// call that knows it
+struct SchemeError : public std::runtime_error {
     using std::runtime_error::runtime_error;
+
+    SchemeError(const std::string& message, SourceSpan span)
+        : std::runtime_error(message), span(span) {
+    }
+
+    SourceSpan span;
 };
 
-struct NameError : public std::runtime_error {
-    using std::runtime_error::runtime_error;
+struct SyntaxError : public SchemeError {
+    using SchemeError::SchemeError;
+};
+
+struct RuntimeError : public SchemeError {
+    using SchemeError::SchemeError;
+};
+
+struct NameError : public SchemeError {
+    using SchemeError::SchemeError;
+};
+
+enum class ErrorKind { SYNTAX, NAME, RUNTIME };
+
+// an error passed by value instead of being thrown
+struct Diagnostic {
+    ErrorKind kind = ErrorKind::RUNTIME;
+    std::string message;
+    SourceSpan span;
+
+    static Diagnostic FromError(const SchemeError& error);
+
+    const char* GetKindName() const {
+        switch (kind) {
+            case ErrorKind::SYNTAX:
+                return "syntax";
+            case ErrorKind::NAME:
+                return "name";
+            default:
+                return "runtime";
+        }
+    }
+    // e.g. "3:14: unexpected ')'"
+    std::string ToString() const {
+        return span.IsKnown() ? span.ToString() + ": " + message : message;
+    }
+    // throws the error of the matching type
+    [[noreturn]] void Throw() const {
+        switch (kind) {
+            case ErrorKind::SYNTAX:
+                throw SyntaxError(message, span);
+            case ErrorKind::NAME:
+                throw NameError(message, span);
+            default:
+                throw RuntimeError(message, span);
+        }
+    }
+};
+
+inline Diagnostic Diagnostic::FromError(const SchemeError& error) {
+    ErrorKind kind = ErrorKind::RUNTIME;
+    if (dynamic_cast<const SyntaxError*>(&error)) {
+        kind = ErrorKind::SYNTAX;
+    } else if (dynamic_cast<const NameError*>(&error)) {
+        kind = ErrorKind::NAME;
+    }
+    return {kind, error.what(), error.span};
+}
+
+// either a value or the error that prevented it
+template <class T>
+class Expected {
+public:
+    Expected(T value) : value_(std::in_place_index<0>, std::move(value)) {
+    }
+    Expected(Diagnostic error) : value_(std::in_place_index<1>, std::move(error)) {
+    }
+
+    bool IsOk() const {
+        return value_.index() == 0;
+    }
+    explicit operator bool() const {
+        return IsOk();
+    }
+
+    const T& GetValue() const {
+        return std::get<0>(value_);
+    }
+    T& GetValue() {
+        return std::get<0>(value_);
+    }
+    const Diagnostic& GetError() const {
+        return std::get<1>(value_);
+    }
+
+    // the value, or throws the error
+    T ValueOrThrow() && {
+        if (!IsOk()) {
+            GetError().Throw();
+        }
+        return std::move(std::get<0>(value_));
+    }
+
+private:
+    std::variant<T, Diagnostic> value_;
 };
@@ -0,0 +1,399 @@
+// cost scaling harness of the evaluator
+//
+// every case generates random well-formed expressions of growing size, evaluates them
+// and records the time and the object allocations of every input against its length in
+// characters. the growth of the cost with the size is fitted on a log-log scale over the
+// larger inputs, and a case whose time or allocations grow faster than linearly is
+// flagged. the inputs depend only on the seed, so the records saved with --save can be
+// compared with a later run by --baseline, which flags the cases that got more expensive
+//
+// usage: scheme_cost [--seed N] [--max-size N] [--reps N] [--threshold X]
+//                    [--filter SUBSTRING] [--save FILE] [--baseline FILE]
+//                    [--tolerance X] [--corpus DIR]
+// exits with 1 when a case is flagged
+
+#include "scheme.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMinSize = 64;
+// generated expressions are kept well below the nesting limit of the parser
+constexpr size_t kMaxDepth = 32;
+// slopes are fitted over the inputs at least this fraction of the largest size
+constexpr double kFitFraction = 1.0 / 8;
+
+class Generator {
+public:
+    explicit Generator(uint64_t seed) : rng_(seed) {
+    }
+
+    size_t Uniform(size_t lo, size_t hi) {
+        return std::uniform_int_distribution<size_t>(lo, hi)(rng_);
+    }
+
+    std::string Number() {
+        return std::to_string(static_cast<int64_t>(Uniform(0, 200)) - 100);
+    }
+    std::string Numbers(size_t cnt) {
+        std::string res;
+        for (size_t i = 0; i < cnt; ++i) {
+            res += (i ? " " : "") + Number();
+        }
+        return res;
+    }
+    std::string QuotedList(size_t cnt) {
+        return "(quote (" + Numbers(cnt) + "))";
+    }
+    std::string Text(size_t size) {
+        std::string res = "\"";
+        for (size_t i = 0; i < size; ++i) {
+            res += static_cast<char>('a' + Uniform(0, 25));
+        }
+        return res + "\"";
+    }
+
+    // a random numeric expression of about size nodes
+    std::string NumExpr(size_t size, size_t depth = 0) {
+        if (size <= 1 || depth == kMaxDepth) {
+            return NumLeaf();
+        }
+        static const char* const kOps[] = {"+", "-", "*", "max", "min", "abs"};
+        std::string op = kOps[Uniform(0, std::size(kOps) - 1)];
+        size_t args = op == "abs" ? 1 : Uniform(op == "-" ? 2 : 1, 4);
+        return "(" + op + Split(size - 1, args, [&](size_t part) {
+                   return NumExpr(part, depth + 1);
+               }) + ")";
+    }
+
+    // a random boolean expression of about size nodes
+    std::string BoolExpr(size_t size, size_t depth = 0) {
+        if (size <= 3 || depth == kMaxDepth) {
+            static const char* const kCmps[] = {"<", ">", "=", "<=", ">="};
+            return std::string("(") + kCmps[Uniform(0, std::size(kCmps) - 1)] + " " + NumLeaf() +
+                   " " + NumLeaf() + ")";
+        }
+        std::string op = Uniform(0, 1) ? "and" : "or";
+        return "(" + op + Split(size - 1, Uniform(1, 4), [&](size_t part) {
+                   return BoolExpr(part, depth + 1);
+               }) + ")";
+    }
+
+private:
+    std::string NumLeaf() {
+        switch (Uniform(0, 5)) {
+            case 0:
+                return "(string-length " + Text(Uniform(0, 20)) + ")";
+            case 1:
+                return "(list-ref " + QuotedList(3) + " " + std::to_string(Uniform(0, 2)) + ")";
+            case 2:
+                return "(vector-ref (vector " + Numbers(3) + ") " + std::to_string(Uniform(0, 2)) +
+                       ")";
+            case 3:
+                return "(car " + QuotedList(2) + ")";
+            default:
+                return Number();
+        }
+    }
+
+    // the arguments of a call, size is split between them at random
+    template <class F>
+    std::string Split(size_t size, size_t args, F&& make) {
+        std::string res;
+        for (size_t i = 0; i < args; ++i) {
+            size_t left = args - i - 1;
+            // every argument after this one gets at least one node
+            size_t most = std::max<size_t>(1, size - std::min(size, left));
+            size_t part = left == 0 ? size : Uniform(1, most);
+            size -= std::min(size, part);
+            res += " " + make(std::max<size_t>(part, 1));
+        }
+        return res;
+    }
+
+    std::mt19937_64 rng_;
+};
+
+struct Case {
+    std::string name;
+    // an expression of about size nodes, a string literal counts its characters
+    std::function<std::string(Generator&, size_t)> make;
+};
+
+std::vector<Case> MakeCases() {
+    return {
+        {"arithmetic", [](Generator& gen, size_t n) { return gen.NumExpr(n); }},
+        {"logic", [](Generator& gen, size_t n) { return gen.BoolExpr(n); }},
+        {"list", [](Generator& gen, size_t n) { return "(list " + gen.Numbers(n) + ")"; }},
+        {"list?", [](Generator& gen, size_t n) { return "(list? " + gen.QuotedList(n) + ")"; }},
+        {"list-ref",
+         [](Generator& gen, size_t n) {
+             return "(list-ref " + gen.QuotedList(n) + " " + std::to_string(n - 1) + ")";
+         }},
+        {"list-tail",
+         [](Generator& gen, size_t n) {
+             return "(car (list-tail " + gen.QuotedList(n) + " " + std::to_string(n / 2) + "))";
+         }},
+        {"compare", [](Generator&, size_t n) {
+             std::string res = "(<";
+             for (size_t i = 0; i < n; ++i) {
+                 res += " " + std::to_string(i);
+             }
+             return res + ")";
+         }},
+        {"vector-sum",
+         [](Generator& gen, size_t n) { return "(vector-sum (vector " + gen.Numbers(n) + "))"; }},
+        {"vector-dot",
+         [](Generator& gen, size_t n) {
+             return "(vector-dot (make-vector " + std::to_string(n) + " 2) (vector " +
+                    gen.Numbers(n) + "))";
+         }},
+        {"sort", [](Generator& gen, size_t n) { return "(sort " + gen.QuotedList(n) + " <)"; }},
+        {"par-map",
+         [](Generator& gen, size_t n) { return "(par-map abs (vector " + gen.Numbers(n) + "))"; }},
+        {"string-append",
+         [](Generator& gen, size_t n) {
+             std::string res = "(string-length (string-append";
+             for (size_t i = 0; i < n; ++i) {
+                 res += " " + gen.Text(gen.Uniform(0, 24));
+             }
+             return res + "))";
+         }},
+        {"substring",
+         [](Generator& gen, size_t n) {
+             return "(string-length (substring " + gen.Text(n) + " 1 " + std::to_string(n - 1) +
+                    "))";
+         }},
+        {"print", [](Generator& gen, size_t n) { return gen.QuotedList(n); }},
+    };
+}
+
+struct Record {
+    size_t size = 0;
+    double time_ns = 0;
+    uint64_t allocations = 0;
+};
+
+// the best time of reps runs of the whole Interpreter::Run, and its allocations
+Record Measure(const std::string& expr, size_t reps) {
+    Record record;
+    record.size = expr.size();
+    record.time_ns = INFINITY;
+    Interpreter interpreter;
+    for (size_t i = 0; i < reps; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        auto res = interpreter.TryRun(expr);
+        auto time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                            start)
+                        .count();
+        if (!res) {
+            throw std::runtime_error("generated a bad input: " + res.GetError().ToString() +
+                                     "\n" + expr);
+        }
+        record.time_ns = std::min(record.time_ns, time);
+        record.allocations = interpreter.GetLastRunAllocations();
+    }
+    return record;
+}
+
+double GetTime(const Record& record) {
+    return record.time_ns;
+}
+double GetAllocations(const Record& record) {
+    return record.allocations;
+}
+using Cost = double (*)(const Record&);
+
+// the slope of log(cost) over log(size) by least squares, 1 for linear growth
+double FitSlope(const std::vector<Record>& records, Cost cost) {
+    size_t max_size = 0;
+    for (auto& record : records) {
+        max_size = std::max(max_size, record.size);
+    }
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    size_t n = 0;
+    for (auto& record : records) {
+        if (record.size < max_size * kFitFraction || cost(record) <= 0) {
+            continue;
+        }
+        double x = std::log(record.size);
+        double y = std::log(cost(record));
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        ++n;
+    }
+    double det = n * sxx - sx * sx;
+    return n < 2 || det == 0 ? 0 : (n * sxy - sx * sy) / det;
+}
+
+double Total(const std::vector<Record>& records, Cost cost) {
+    double total = 0;
+    for (auto& record : records) {
+        total += cost(record);
+    }
+    return total;
+}
+
+// case name -> records, as written by --save
+using Records = std::map<std::string, std::vector<Record>>;
+
+void Save(const std::string& path, const Records& records) {
+    std::ofstream out{path};
+    for (auto& [name, list] : records) {
+        for (auto& record : list) {
+            out << name << '\t' << record.size << '\t' << record.time_ns << '\t'
+                << record.allocations << '\n';
+        }
+    }
+}
+
+Records Load(const std::string& path) {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    Records records;
+    std::string name;
+    Record record;
+    while (in >> name >> record.size >> record.time_ns >> record.allocations) {
+        records[name].push_back(record);
+    }
+    return records;
+}
+
+struct Options {
+    uint64_t seed = 1;
+    size_t max_size = 8192;
+    size_t reps = 5;
+    // inputs per size
+    size_t inputs = 3;
+    double threshold = 1.3;
+    double tolerance = 0.5;
+    std::string filter;
+    std::string save;
+    std::string baseline;
+    std::string corpus;
+};
+
+int Run(const Options& options) {
+    Records baseline;
+    if (!options.baseline.empty()) {
+        baseline = Load(options.baseline);
+    }
+
+    Records all;
+    bool flagged = false;
+    size_t corpus_files = 0;
+    std::printf("%-14s %8s %12s %12s %10s %10s  %s\n", "case", "size", "time, us",
+                "allocations", "time exp", "alloc exp", "");
+    for (auto& test : MakeCases()) {
+        if (test.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        Generator gen{options.seed};
+        auto& records = all[test.name];
+        for (size_t n = kMinSize; n <= options.max_size; n *= 2) {
+            for (size_t i = 0; i < options.inputs; ++i) {
+                auto expr = test.make(gen, n);
+                records.push_back(Measure(expr, options.reps));
+                if (!options.corpus.empty() && n == kMinSize) {
+                    std::ofstream{options.corpus + "/" + test.name + "-" + std::to_string(i)}
+                        << expr;
+                    ++corpus_files;
+                }
+            }
+        }
+
+        // allocations are exact, time is noisy, so it gets more slack
+        double time_slope = FitSlope(records, GetTime);
+        double alloc_slope = FitSlope(records, GetAllocations);
+        std::string verdict;
+        if (time_slope > options.threshold || alloc_slope > 1 + (options.threshold - 1) / 2) {
+            verdict = "superlinear";
+        }
+
+        auto it = baseline.find(test.name);
+        if (it != baseline.end() && it->second.size() == records.size()) {
+            double time_ratio = Total(records, GetTime) / Total(it->second, GetTime);
+            double alloc_ratio =
+                Total(records, GetAllocations) / std::max(1.0, Total(it->second, GetAllocations));
+            if (time_ratio > 1 + options.tolerance || alloc_ratio > 1.01) {
+                char buf[96];
+                std::snprintf(buf, sizeof(buf),
+                              "%sslower than baseline: time x%.2f, allocations x%.2f",
+                              verdict.empty() ? "" : ", ", time_ratio, alloc_ratio);
+                verdict += buf;
+            }
+        }
+        flagged |= !verdict.empty();
+
+        auto& last = records.back();
+        std::printf("%-14s %8zu %12.1f %12llu %10.2f %10.2f  %s\n", test.name.c_str(), last.size,
+                    last.time_ns / 1e3, static_cast<unsigned long long>(last.allocations),
+                    time_slope, alloc_slope, verdict.c_str());
+        std::fflush(stdout);
+    }
+
+    if (!options.save.empty()) {
+        Save(options.save, all);
+    }
+    if (corpus_files) {
+        std::printf("%zu inputs written to %s\n", corpus_files, options.corpus.c_str());
+    }
+    return flagged ? 1 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value) {
+            options.seed = std::stoull(argv[++i]);
+        } else if (arg == "--max-size" && has_value) {
+            options.max_size = std::max<size_t>(std::stoull(argv[++i]), kMinSize);
+        } else if (arg == "--reps" && has_value) {
+            options.reps = std::max<size_t>(std::stoull(argv[++i]), 1);
+        } else if (arg == "--threshold" && has_value) {
+            options.threshold = std::stod(argv[++i]);
+        } else if (arg == "--tolerance" && has_value) {
+            options.tolerance = std::stod(argv[++i]);
+        } else if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--save" && has_value) {
+            options.save = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            options.baseline = argv[++i];
+        } else if (arg == "--corpus" && has_value) {
+            options.corpus = argv[++i];
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--seed N] [--max-size N] [--reps N] [--threshold X]\n"
+                         "          [--filter SUBSTRING] [--save FILE] [--baseline FILE]\n"
+                         "          [--tolerance X] [--corpus DIR]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    try {
+        return Run(options);
+    } catch (const std::exception& error) {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 2;
+    }
+}
@@ -0,0 +1,65 @@
+// fuzz target of the reader and the evaluator
+//
+// every input is run by a fresh Interpreter through TryRun and through Run, the two
+// must agree on the result or the error, and a printed result must read back into a
+// value that prints the same. with clang and -DSCHEME_LIBFUZZER=ON it is the
+// libFuzzer binary scheme_fuzz, with any compiler it is also linked with replay.cpp
+// into scheme_fuzz_replay, which runs saved inputs. configure with -DSCHEME_SANITIZE=ON
+// for address and undefined behaviour checks
+
+#include "scheme.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+[[noreturn]] void Fail(const std::string& expr, const char* what, const std::string& lhs,
+                       const std::string& rhs) {
+    std::fprintf(stderr, "%s on %s\n  %s\n  %s\n", what, expr.c_str(), lhs.c_str(),
+                 rhs.c_str());
+    std::abort();
+}
+
+std::string Describe(const Expected<std::string>& res) {
+    return res ? "ok " + res.GetValue() : "error " + res.GetError().ToString();
+}
+
+// opaque objects print as #<...>, vectors as #(...) which the reader has no syntax for,
+// and symbols made from strings may hold any characters
+bool CanReadBack(const std::string& expr, const std::string& printed) {
+    return printed.find("#<") == std::string::npos && printed.find("#(") == std::string::npos &&
+           expr.find("string->symbol") == std::string::npos;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string expr(reinterpret_cast<const char*>(data), size);
+    auto expected = Interpreter{}.TryRun(expr);
+
+    std::string thrown;
+    try {
+        Interpreter interpreter;
+        thrown = "ok " + interpreter.Run(expr);
+    } catch (const SchemeError& error) {
+        thrown = "error " + Diagnostic::FromError(error).ToString();
+    }
+    if (Describe(expected) != thrown) {
+        Fail(expr, "TryRun and Run disagree", Describe(expected), thrown);
+    }
+
+    if (expected && CanReadBack(expr, expected.GetValue())) {
+        auto& printed = expected.GetValue();
+        auto read = TryReadFullString(printed);
+        if (!read) {
+            Fail(expr, "the result doesn't read back", printed, read.GetError().ToString());
+        }
+        auto reprinted = RepresentAsStr(read.GetValue());
+        if (reprinted != printed) {
+            Fail(expr, "the result prints differently after reading", printed, reprinted);
+        }
+    }
+    return 0;
+}
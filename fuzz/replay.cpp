@@ -0,0 +1,77 @@
+// runs the fuzz target over saved inputs, for builds without libFuzzer
+//
+// usage: scheme_fuzz_replay [--lines] PATH...
+// every file, or every file in a directory, is one input; with --lines every
+// line of the files is an input of its own, e.g. aot/differential.scm
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+void RunInput(const std::string& input) {
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+}
+
+// the number of inputs run
+size_t RunFile(const std::filesystem::path& path, bool lines) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 0;
+    }
+    if (!lines) {
+        std::stringstream ss;
+        ss << in.rdbuf();
+        RunInput(ss.str());
+        return 1;
+    }
+    size_t cnt = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        RunInput(line);
+        ++cnt;
+    }
+    return cnt;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool lines = false;
+    std::vector<std::filesystem::path> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lines") {
+            lines = true;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        std::fprintf(stderr, "usage: %s [--lines] PATH...\n", argv[0]);
+        return 2;
+    }
+
+    size_t cnt = 0;
+    for (auto& path : paths) {
+        if (std::filesystem::is_directory(path)) {
+            for (auto& entry : std::filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file()) {
+                    cnt += RunFile(entry.path(), lines);
+                }
+            }
+        } else {
+            cnt += RunFile(path, lines);
+        }
+    }
+    std::printf("%zu inputs, no failures\n", cnt);
+    return 0;
+}
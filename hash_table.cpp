@@ -0,0 +1,222 @@
+#include "hash_table.h"
+
+namespace {
+
+constexpr size_t kInitialCapacity = 8;
+constexpr uint64_t kOccupiedBit = 1ull << 63;
+
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t Combine(uint64_t seed, uint64_t value) {
+    return Mix(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)));
+}
+
+enum HashTag : uint64_t { NIL = 1, TRUE, FALSE, LIST, DOTTED, VECTOR, STRING, CHAR };
+
+}  // namespace
+
+uint64_t HashObject(const std::shared_ptr<Object>& obj) {
+    if (!obj) {
+        return Mix(HashTag::NIL);
+    } else if (Is<Number>(obj)) {
+        return Mix(As<Number>(obj)->GetValue());
+    } else if (Is<Symbol>(obj)) {
+        return Mix(reinterpret_cast<uintptr_t>(As<Symbol>(obj)->GetInternedName()));
+    } else if (Is<Bool>(obj)) {
+        return Mix(As<Bool>(obj)->IsTrue() ? HashTag::TRUE : HashTag::FALSE);
+    } else if (Is<String>(obj)) {
+        return Combine(HashTag::STRING, std::hash<std::string_view>{}(As<String>(obj)->GetView()));
+    } else if (Is<Char>(obj)) {
+        return Combine(HashTag::CHAR, static_cast<unsigned char>(As<Char>(obj)->GetValue()));
+    } else if (Is<Cell>(obj)) {
+        // walk the spine in a loop, so that long lists don't eat the stack
+        uint64_t hash = HashTag::LIST;
+        auto cur = obj;
+        while (Is<Cell>(cur)) {
+            auto cell = As<Cell>(cur);
+            hash = Combine(hash, HashObject(cell->GetFirst()));
+            cur = cell->GetSecond();
+        }
+        if (cur) {
+            hash = Combine(Combine(hash, HashTag::DOTTED), HashObject(cur));
+        }
+        return hash;
+    } else if (Is<Vector>(obj)) {
+        auto vector = As<Vector>(obj);
+        uint64_t hash = HashTag::VECTOR;
+        if (vector->IsPacked()) {
+            for (auto value : vector->GetPacked()) {
+                hash = Combine(hash, Mix(value));
+            }
+        } else {
+            for (size_t i = 0; i < vector->GetSize(); ++i) {
+                hash = Combine(hash, HashObject(vector->Get(i)));
+            }
+        }
+        return hash;
+    } else {
+        return Mix(reinterpret_cast<uintptr_t>(obj.get()));
+    }
+}
+
+bool ObjectsEqual(const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+    if (lhs == rhs) {
+        return true;
+    } else if (!lhs || !rhs) {
+        return false;
+    } else if (Is<Number>(lhs)) {
+        return Is<Number>(rhs) && As<Number>(lhs)->GetValue() == As<Number>(rhs)->GetValue();
+    } else if (Is<Symbol>(lhs)) {
+        return Is<Symbol>(rhs) &&
+               As<Symbol>(lhs)->GetInternedName() == As<Symbol>(rhs)->GetInternedName();
+    } else if (Is<Bool>(lhs)) {
+        return Is<Bool>(rhs) && As<Bool>(lhs)->IsTrue() == As<Bool>(rhs)->IsTrue();
+    } else if (Is<String>(lhs)) {
+        return Is<String>(rhs) && As<String>(lhs)->GetView() == As<String>(rhs)->GetView();
+    } else if (Is<Char>(lhs)) {
+        return Is<Char>(rhs) && As<Char>(lhs)->GetValue() == As<Char>(rhs)->GetValue();
+    } else if (Is<Cell>(lhs)) {
+        auto left = lhs;
+        auto right = rhs;
+        while (Is<Cell>(left) && Is<Cell>(right)) {
+            if (!ObjectsEqual(As<Cell>(left)->GetFirst(), As<Cell>(right)->GetFirst())) {
+                return false;
+            }
+            left = As<Cell>(left)->GetSecond();
+            right = As<Cell>(right)->GetSecond();
+        }
+        return !Is<Cell>(left) && !Is<Cell>(right) && ObjectsEqual(left, right);
+    } else if (Is<Vector>(lhs)) {
+        if (!Is<Vector>(rhs)) {
+            return false;
+        }
+        auto left = As<Vector>(lhs);
+        auto right = As<Vector>(rhs);
+        if (left->IsPacked() && right->IsPacked()) {
+            return left->GetPacked() == right->GetPacked();
+        }
+        if (left->GetSize() != right->GetSize()) {
+            return false;
+        }
+        for (size_t i = 0; i < left->GetSize(); ++i) {
+            if (!ObjectsEqual(left->Get(i), right->Get(i))) {
+                return false;
+            }
+        }
+        return true;
+    } else {
+        return false;
+    }
+}
+
+HashTable::HashTable() : hashes_(kInitialCapacity), entries_(kInitialCapacity) {
+    TrackBuffers();
+}
+
+void HashTable::TrackBuffers() {
+    TrackBufferBytes(hashes_.capacity() * sizeof(uint64_t) + entries_.capacity() * sizeof(Entry));
+}
+
+size_t HashTable::FindSlot(const std::shared_ptr<Object>& key, uint64_t hash) const {
+    size_t mask = hashes_.size() - 1;
+    size_t i = hash & mask;
+    while (hashes_[i] != 0) {
+        if (hashes_[i] == hash && ObjectsEqual(entries_[i].key, key)) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+const std::shared_ptr<Object>* HashTable::Find(const std::shared_ptr<Object>& key) const {
+    size_t i = FindSlot(key, HashObject(key) | kOccupiedBit);
+    if (hashes_[i] == 0) {
+        return nullptr;
+    }
+    return &entries_[i].value;
+}
+
+void HashTable::Insert(const std::shared_ptr<Object>& key, const std::shared_ptr<Object>& value) {
+    if (frozen_) {
+        throw RuntimeError("hash table belongs to a snapshot and can't be changed");
+    }
+    uint64_t hash = HashObject(key) | kOccupiedBit;
+    size_t i = FindSlot(key, hash);
+    if (hashes_[i] != 0) {
+        entries_[i].value = value;
+        return;
+    }
+    if ((size_ + 1) * 4 > hashes_.size() * 3) {
+        Grow();
+        i = FindSlot(key, hash);
+    }
+    hashes_[i] = hash;
+    entries_[i] = Entry{key, value};
+    ++size_;
+}
+
+bool HashTable::Erase(const std::shared_ptr<Object>& key) {
+    if (frozen_) {
+        throw RuntimeError("hash table belongs to a snapshot and can't be changed");
+    }
+    size_t i = FindSlot(key, HashObject(key) | kOccupiedBit);
+    if (hashes_[i] == 0) {
+        return false;
+    }
+    size_t mask = hashes_.size() - 1;
+    for (size_t j = (i + 1) & mask; hashes_[j] != 0; j = (j + 1) & mask) {
+        // the entry at j may fill the hole at i only if its home slot
+        // does not lie cyclically in (i, j]
+        size_t home = hashes_[j] & mask;
+        bool stays = (i < j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            hashes_[i] = hashes_[j];
+            entries_[i] = std::move(entries_[j]);
+            i = j;
+        }
+    }
+    hashes_[i] = 0;
+    entries_[i] = Entry{};
+    --size_;
+    return true;
+}
+
+void HashTable::Freeze(std::vector<Object*>* children) {
+    if (frozen_) {
+        return;
+    }
+    frozen_ = true;
+    for (auto& entry : entries_) {
+        children->push_back(entry.key.get());
+        children->push_back(entry.value.get());
+    }
+}
+
+void HashTable::Grow() {
+    std::vector<uint64_t> old_hashes(hashes_.size() * 2);
+    std::vector<Entry> old_entries(entries_.size() * 2);
+    old_hashes.swap(hashes_);
+    old_entries.swap(entries_);
+
+    size_t mask = hashes_.size() - 1;
+    for (size_t i = 0; i < old_hashes.size(); ++i) {
+        if (old_hashes[i] == 0) {
+            continue;
+        }
+        size_t j = old_hashes[i] & mask;
+        while (hashes_[j] != 0) {
+            j = (j + 1) & mask;
+        }
+        hashes_[j] = old_hashes[i];
+        entries_[j] = std::move(old_entries[i]);
+    }
+    TrackBuffers();
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "object.h"
+
+// structural hash and equality, the same that equal? would use: numbers by value,
+// symbols by interned name, lists and vectors element by element, everything else
+// by identity
+uint64_t HashObject(const std::shared_ptr<Object>& obj);
+bool ObjectsEqual(const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs);
+
+class HashTable : public Object, private Counted<HashTable> {
+public:
+    static constexpr ObjectKind kKind = ObjectKind::HASH_TABLE;
+
+    HashTable();
+
+    // returns nullptr when there is no such key
+    const std::shared_ptr<Object>* Find(const std::shared_ptr<Object>& key) const;
+    void Insert(const std::shared_ptr<Object>& key, const std::shared_ptr<Object>& value);
+    bool Erase(const std::shared_ptr<Object>& key);
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+    void Freeze(std::vector<Object*>* children) override;
+
+private:
+    struct Entry {
+        std::shared_ptr<Object> key;
+        std::shared_ptr<Object> value;
+    };
+
+    // open addressing with linear probing. hashes of the slots are kept in a separate
+    // array, so that a probe walks over a few cache lines of integers and compares the
+    // keys themselves only when the full hashes match. zero marks an empty slot,
+    // removal shifts the following entries back, so there are no tombstones
+    size_t FindSlot(const std::shared_ptr<Object>& key, uint64_t hash) const;
+    void Grow();
+    void TrackBuffers();
+
+    std::vector<uint64_t> hashes_;
+    std::vector<Entry> entries_;
+    size_t size_ = 0;
+    bool frozen_ = false;
+};
+
+class MakeHashTable : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        if (args) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return std::make_shared<HashTable>();
+    }
+};
+class HashTableRef : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2 && obj.size() != 3) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto value = As<HashTable>(obj[0])->Find(obj[1]);
+        if (value) {
+            return *value;
+        } else if (obj.size() == 3) {
+            return obj[2];
+        } else {
+            throw RuntimeError("no such key in hash table");
+        }
+    }
+};
+class HashTableSet : public Func {
+    // returns the table itself, so that updates can be chained
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 3) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto table = As<HashTable>(obj[0]);
+        table->Insert(obj[1], obj[2]);
+        return table;
+    }
+};
+class HashTableDelete : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto table = As<HashTable>(obj[0]);
+        table->Erase(obj[1]);
+        return table;
+    }
+};
+class HashTableCount : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        int64_t size = As<HashTable>(obj[0])->GetSize();
+        return std::make_shared<Number>(ConstantToken{size});
+    }
+};
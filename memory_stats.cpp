@@ -0,0 +1,102 @@
+#include "memory_stats.h"
+
+#include <atomic>
+#include <utility>
+
+namespace {
+
+constexpr size_t kKinds = static_cast<size_t>(ObjectKind::COUNT);
+
+const char* const kKindNames[kKinds] = {"number",  "bool",       "symbol",  "cell",
+                                        "vector",  "hash-table", "promise", "string",
+                                        "char",    "string-buffer"};
+
+// counters of a kind share a cache line, different kinds don't
+struct alignas(64) Counters {
+    std::atomic<uint64_t> live;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> peak_live;
+    std::atomic<uint64_t> peak_bytes;
+    std::atomic<uint64_t> allocations;
+};
+
+// zero initialized before any dynamic initialization,
+// the builtins are allocated during the static one already
+Counters counters[kKinds];
+std::atomic<uint64_t> runs;
+std::atomic<uint64_t> run_allocations;
+
+thread_local uint64_t thread_allocations = 0;
+
+void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t value) {
+    uint64_t cur = peak.load(std::memory_order_relaxed);
+    while (value > cur && !peak.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+Counters& Get(ObjectKind kind) {
+    return counters[static_cast<size_t>(kind)];
+}
+
+}  // namespace
+
+void MemoryTracker::OnAlloc(ObjectKind kind, size_t bytes) {
+    auto& c = Get(kind);
+    ++thread_allocations;
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    UpdatePeak(c.peak_live, c.live.fetch_add(1, std::memory_order_relaxed) + 1);
+    UpdatePeak(c.peak_bytes, c.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void MemoryTracker::OnFree(ObjectKind kind, size_t bytes) {
+    auto& c = Get(kind);
+    c.live.fetch_sub(1, std::memory_order_relaxed);
+    c.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::OnResize(ObjectKind kind, size_t old_bytes, size_t new_bytes) {
+    auto& c = Get(kind);
+    if (new_bytes >= old_bytes) {
+        size_t delta = new_bytes - old_bytes;
+        UpdatePeak(c.peak_bytes, c.bytes.fetch_add(delta, std::memory_order_relaxed) + delta);
+    } else {
+        c.bytes.fetch_sub(old_bytes - new_bytes, std::memory_order_relaxed);
+    }
+}
+
+uint64_t MemoryTracker::GetThreadAllocations() {
+    return thread_allocations;
+}
+
+uint64_t MemoryTracker::ExchangeThreadAllocations(uint64_t allocations) {
+    return std::exchange(thread_allocations, allocations);
+}
+
+void MemoryTracker::RecordRun(uint64_t allocations) {
+    runs.fetch_add(1, std::memory_order_relaxed);
+    run_allocations.fetch_add(allocations, std::memory_order_relaxed);
+}
+
+MemoryStats MemoryTracker::GetStats() {
+    MemoryStats stats;
+    for (size_t i = 0; i < kKinds; ++i) {
+        KindStats kind;
+        kind.name = kKindNames[i];
+        kind.live = counters[i].live.load(std::memory_order_relaxed);
+        kind.bytes = counters[i].bytes.load(std::memory_order_relaxed);
+        kind.peak_live = counters[i].peak_live.load(std::memory_order_relaxed);
+        kind.peak_bytes = counters[i].peak_bytes.load(std::memory_order_relaxed);
+        kind.allocations = counters[i].allocations.load(std::memory_order_relaxed);
+        stats.kinds.push_back(kind);
+    }
+    stats.runs = runs.load(std::memory_order_relaxed);
+    stats.run_allocations = run_allocations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MemoryTracker::ResetPeaks() {
+    for (auto& c : counters) {
+        c.peak_live.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        c.peak_bytes.store(c.bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
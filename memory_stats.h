@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// accounting of the interpreter objects by kind. bytes are the sizes of the objects
+// plus the buffers owned by vectors and hash tables and the text of long strings, not
+// counting the allocator overhead
+
+enum class ObjectKind {
+    NUMBER,
+    BOOL,
+    SYMBOL,
+    CELL,
+    VECTOR,
+    HASH_TABLE,
+    PROMISE,
+    STRING,
+    CHAR,
+    STRING_BUFFER,
+    COUNT
+};
+
+struct KindStats {
+    const char* name;
+    uint64_t live = 0;
+    uint64_t bytes = 0;
+    uint64_t peak_live = 0;
+    uint64_t peak_bytes = 0;
+    // allocated since the start of the program
+    uint64_t allocations = 0;
+};
+
+struct MemoryStats {
+    std::vector<KindStats> kinds;
+    // number of Interpreter::Run calls and the objects they allocated, on their threads
+    // or in the ThreadPool::ParallelFor tasks they waited for
+    uint64_t runs = 0;
+    uint64_t run_allocations = 0;
+};
+
+class MemoryTracker {
+public:
+    static void OnAlloc(ObjectKind kind, size_t bytes);
+    static void OnFree(ObjectKind kind, size_t bytes);
+    static void OnResize(ObjectKind kind, size_t old_bytes, size_t new_bytes);
+
+    // objects allocated by the current thread since its start
+    static uint64_t GetThreadAllocations();
+    // replaces the counter of the current thread, returns the old value. the scheduler
+    // swaps in the counter of the evaluation it resumes
+    static uint64_t ExchangeThreadAllocations(uint64_t allocations);
+    static void RecordRun(uint64_t allocations);
+
+    static MemoryStats GetStats();
+    // peaks start over from the current values
+    static void ResetPeaks();
+};
+
+// base for the object classes: counts the instances of T as T::kKind
+template <class T>
+class Counted {
+protected:
+    Counted() {
+        MemoryTracker::OnAlloc(T::kKind, sizeof(T));
+    }
+    Counted(const Counted&) : Counted() {
+    }
+    ~Counted() {
+        MemoryTracker::OnFree(T::kKind, sizeof(T) + buffer_bytes_);
+    }
+
+    // to be called whenever the buffers owned by the object change their size
+    void TrackBufferBytes(size_t bytes) {
+        MemoryTracker::OnResize(T::kKind, buffer_bytes_, bytes);
+        buffer_bytes_ = bytes;
+    }
+
+private:
+    size_t buffer_bytes_ = 0;
+};
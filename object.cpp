@@ -1,79 +1,257 @@
 #include "object.h"
 
-std::map<std::string, std::shared_ptr<Func>> Symbol::symbol_map = {
-    {"boolean?", std::make_shared<IsBool>()},
-    {"not", std::make_shared<Not>()},
-    {"and", std::make_shared<And>()},
-    {"or", std::make_shared<Or>()},
-    {"quote", std::make_shared<Quote>()},
-    {"pair?", std::make_shared<IsPair>()},
-    {"null?", std::make_shared<IsNull>()},
-    {"list?", std::make_shared<IsList>()},
-    {"cons", std::make_shared<Cons>()},
-    {"car", std::make_shared<Car>()},
-    {"cdr", std::make_shared<Cdr>()},
-    {"list", std::make_shared<List>()},
-    {"list-ref", std::make_shared<ListRef>()},
-    {"list-tail", std::make_shared<ListTail>()},
-    {"number?", std::make_shared<IsNumber>()},
-    {"=", std::make_shared<IsEqual>()},
-    {">", std::make_shared<IsDecrease>()},
-    {"<", std::make_shared<IsIncrease>()},
-    {">=", std::make_shared<IsNonIncrease>()},
-    {"<=", std::make_shared<IsNonDecrease>()},
-    {"+", std::make_shared<Sum>()},
-    {"-", std::make_shared<Sub>()},
-    {"*", std::make_shared<Prod>()},
-    {"/", std::make_shared<Div>()},
-    {"max", std::make_shared<Max>()},
-    {"min", std::make_shared<Min>()},
-    {"abs", std::make_shared<Abs>()}};
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
-void GetVector(const std::shared_ptr<Object>& args, std::vector<std::shared_ptr<Object>>& obj) {
-    if (args) {
-        if (!Is<Cell>(args)) {
-            obj.push_back(args->Eval());
+namespace {
+
+// names are spread over the shards by hash, so that threads interning different
+// names rarely wait for each other
+constexpr size_t kInternShards = 16;
+
+struct InternedName {
+    std::string name;
+    bool permanent = false;
+    // the symbols made at run time share it, the name goes with the last of them.
+    // a new pointer may be made while the deleter of the expired one is waiting for
+    // the lock, so the entry stays until the deleters of all of them have run
+    std::weak_ptr<const std::string> temporary;
+    size_t temporary_owners = 0;
+};
+
+struct alignas(64) InternShard {
+    std::mutex mutex;
+    // the keys point into the names
+    std::unordered_map<std::string_view, std::unique_ptr<InternedName>> names;
+};
+
+// never destroyed, symbols may outlive the static destructors of this file
+InternShard& GetInternShard(std::string_view name) {
+    static auto shards = new InternShard[kInternShards];
+    return shards[std::hash<std::string_view>{}(name) % kInternShards];
+}
+
+InternedName& FindOrInsert(InternShard& shard, std::string_view name) {
+    auto it = shard.names.find(name);
+    if (it != shard.names.end()) {
+        return *it->second;
+    }
+    auto entry = std::make_unique<InternedName>();
+    entry->name = name;
+    auto& res = *entry;
+    shard.names.emplace(res.name, std::move(entry));
+    return res;
+}
+
+}  // namespace
+
+const std::string* Symbol::Intern(std::string_view name) {
+    auto& shard = GetInternShard(name);
+    std::lock_guard lock{shard.mutex};
+    auto& entry = FindOrInsert(shard, name);
+    entry.permanent = true;
+    return &entry.name;
+}
+
+std::shared_ptr<const std::string> Symbol::InternTemporary(std::string_view name) {
+    auto& shard = GetInternShard(name);
+    std::lock_guard lock{shard.mutex};
+    auto& entry = FindOrInsert(shard, name);
+    if (entry.permanent) {
+        return std::shared_ptr<const std::string>(std::shared_ptr<void>(), &entry.name);
+    }
+    if (auto res = entry.temporary.lock()) {
+        return res;
+    }
+    std::shared_ptr<const std::string> res(&entry.name, [&shard, &entry](const std::string*) {
+        std::lock_guard lock{shard.mutex};
+        if (--entry.temporary_owners == 0 && !entry.permanent) {
+            shard.names.erase(shard.names.find(entry.name));
         }
-        if (!As<Cell>(args)->GetFirst()) {
-            throw RuntimeError("invalid arg, trying to evaluate null cell");
+    });
+    ++entry.temporary_owners;
+    entry.temporary = res;
+    return res;
+}
+
+void FreezeReachable(const std::shared_ptr<Object>& obj) {
+    // a stack instead of recursion, as for the lists, and a visited set, as the cells
+    // of shared tails are reachable more than once
+    std::vector<Object*> pending{obj.get()};
+    std::unordered_set<Object*> visited;
+    while (!pending.empty()) {
+        auto cur = pending.back();
+        pending.pop_back();
+        if (cur && visited.insert(cur).second) {
+            cur->Freeze(&pending);
         }
-        obj.push_back(As<Cell>(args)->GetFirst()->Eval());
-        GetVector(As<Cell>(args)->GetSecond(), obj);
+    }
+}
+
+std::shared_ptr<Object> EvalArg(const std::shared_ptr<Object>& arg) {
+    if (!arg) {
+        throw RuntimeError("invalid arg, trying to evaluate null cell");
+    }
+    return arg->Eval();
+}
+
+// the helpers below walk the lists in loops, so that long lists don't eat the stack
+
+void GetVector(const std::shared_ptr<Object>& args, std::vector<std::shared_ptr<Object>>& obj) {
+    for (auto cur = args; cur; cur = As<Cell>(cur)->GetSecond()) {
+        obj.push_back(EvalArg(As<Cell>(cur)->GetFirst()));
     }
 }
 
 void GetRawVector(const std::shared_ptr<Object>& args, std::vector<std::shared_ptr<Object>>& obj) {
-    if (args) {
-        if (!Is<Cell>(args)) {
-            obj.push_back(args);
+    for (auto cur = args; cur; cur = As<Cell>(cur)->GetSecond()) {
+        if (!Is<Cell>(cur)) {
+            obj.push_back(cur);
             return;
         }
-        obj.push_back(As<Cell>(args)->GetFirst());
-        GetRawVector(As<Cell>(args)->GetSecond(), obj);
+        obj.push_back(As<Cell>(cur)->GetFirst());
     }
 }
 
 std::shared_ptr<Object> GetObjFrowVector(std::vector<std::shared_ptr<Object>>& obj, size_t i) {
-    if (i >= obj.size()) {
-        return nullptr;
-    } else {
+    std::shared_ptr<Object> res;
+    for (size_t j = obj.size(); j-- > i;) {
+        auto cell = std::make_shared<Cell>();
+        cell->SetFirst(obj[j]);
+        cell->SetSecond(res);
+        res = cell;
+    }
+    return res;
+}
+
+std::shared_ptr<Object> MakeArgs(const std::vector<std::shared_ptr<Object>>& values) {
+    static const std::shared_ptr<Object> kQuote = std::make_shared<Symbol>(SymbolToken{"quote"});
+    std::shared_ptr<Object> args;
+    for (size_t i = values.size(); i-- > 0;) {
+        auto arg = values[i];
+        // only numbers and booleans are sure to evaluate to themselves
+        if (!Is<Number>(arg) && !Is<Bool>(arg)) {
+            auto quoted = std::make_shared<Cell>();
+            quoted->SetFirst(arg);
+            auto quote = std::make_shared<Cell>();
+            quote->SetFirst(kQuote);
+            quote->SetSecond(quoted);
+            arg = quote;
+        }
         auto cell = std::make_shared<Cell>();
-        cell->SetFirst(obj[i]);
-        cell->SetSecond(GetObjFrowVector(obj, i + 1));
-        return cell;
+        cell->SetFirst(arg);
+        cell->SetSecond(args);
+        args = cell;
     }
+    return args;
 }
 
-std::shared_ptr<Object> MakeArgsForList(std::shared_ptr<Object>& obj) {
-    auto quoted_expr_cell = std::make_shared<Cell>();
-    quoted_expr_cell->SetFirst(obj);
+std::shared_ptr<Vector> GetPackedVector(const std::shared_ptr<Object>& obj) {
+    auto vector = As<Vector>(obj);
+    if (!vector->IsPacked()) {
+        throw RuntimeError("vector is not numeric");
+    }
+    return vector;
+}
 
-    auto quote_cell = std::make_shared<Cell>();
-    quote_cell->SetFirst(std::make_shared<Symbol>(SymbolToken{"quote"}));
-    quote_cell->SetSecond(quoted_expr_cell);
+std::shared_ptr<Object> Promise::Force() {
+    auto forcer = GetCurrentEvaluation();
+    std::shared_ptr<Object> expr;
+    std::function<std::shared_ptr<Object>()> thunk;
+    {
+        std::lock_guard lock{mutex_};
+        if (state_ == State::FORCED) {
+            return value_;
+        }
+        if (std::find(forcers_.begin(), forcers_.end(), forcer) != forcers_.end()) {
+            throw RuntimeError("promise forced recursively");
+        }
+        forcers_.push_back(forcer);
+        state_ = State::FORCING;
+        expr = expr_;
+        thunk = thunk_;
+    }
 
-    auto args = std::make_shared<Cell>();
-    args->SetFirst(quote_cell);
+    auto finish = [this, forcer] {
+        forcers_.erase(std::find(forcers_.begin(), forcers_.end(), forcer));
+        if (state_ == State::FORCING && forcers_.empty()) {
+            state_ = State::UNFORCED;
+        }
+    };
+    std::shared_ptr<Object> value;
+    try {
+        if (thunk) {
+            value = thunk();
+        } else if (expr) {
+            value = expr->Eval();
+        }
+    } catch (...) {
+        std::lock_guard lock{mutex_};
+        finish();
+        throw;
+    }
 
-    return args;
+    std::lock_guard lock{mutex_};
+    finish();
+    if (frozen_ && state_ != State::FORCED) {
+        return value;
+    }
+    if (state_ != State::FORCED) {
+        value_ = std::move(value);
+        state_ = State::FORCED;
+        // the code is not needed anymore, and it may hold on to a long stream
+        expr_ = nullptr;
+        thunk_ = nullptr;
+    }
+    return value_;
+}
+
+std::shared_ptr<Object> ForceIfPromise(const std::shared_ptr<Object>& obj) {
+    if (Is<Promise>(obj)) {
+        return As<Promise>(obj)->Force();
+    }
+    return obj;
+}
+
+std::shared_ptr<Object> MapStream(const std::shared_ptr<Object>& func,
+                                  const std::shared_ptr<Object>& stream) {
+    if (!stream) {
+        return nullptr;
+    }
+    if (!func) {
+        throw RuntimeError("not a function");
+    }
+    auto cell = As<Cell>(stream);
+    auto res = std::make_shared<Cell>();
+    res->SetFirst(func->Apply(MakeArgs({cell->GetFirst()})));
+    // only the rest of the source is captured, so the consumed part can be freed
+    auto rest = cell->GetSecond();
+    res->SetSecond(std::make_shared<Promise>(
+        [func, rest] { return MapStream(func, ForceIfPromise(rest)); },
+        std::vector<std::shared_ptr<Object>>{func, rest}));
+    return res;
+}
+
+std::shared_ptr<Object> FilterStream(const std::shared_ptr<Object>& pred,
+                                     std::shared_ptr<Object> stream) {
+    if (!pred) {
+        throw RuntimeError("not a function");
+    }
+    while (stream) {
+        auto cell = As<Cell>(stream);
+        auto keep = pred->Apply(MakeArgs({cell->GetFirst()}));
+        if (!Is<Bool>(keep) || As<Bool>(keep)->IsTrue()) {
+            auto res = std::make_shared<Cell>();
+            res->SetFirst(cell->GetFirst());
+            auto rest = cell->GetSecond();
+            res->SetSecond(std::make_shared<Promise>(
+                [pred, rest] { return FilterStream(pred, ForceIfPromise(rest)); },
+                std::vector<std::shared_ptr<Object>>{pred, rest}));
+            return res;
+        }
+        stream = ForceIfPromise(cell->GetSecond());
+    }
+    return nullptr;
 }
\ No newline at end of file
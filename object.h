@@ -1,21 +1,47 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <map>
 #include <vector>
 #include <iostream>
 #include <type_traits>
+#include <functional>
+#include <mutex>
+#include <string_view>
 #include "tokenizer.h"
 #include "error.h"
+#include "simd.h"
+#include "profile.h"
+#include "sampler.h"
+#include "memory_stats.h"
+#include "scheduler.h"
+#include "environment.h"
+#include "builtins.h"
 
 class Object : public std::enable_shared_from_this<Object> {
 public:
+    Object() {
+        SCHEME_PROFILE_ALLOCATION();
+    }
     virtual ~Object() = default;
     virtual std::shared_ptr<Object> Eval() {
+        throw RuntimeError("cannot evaluate");
     }
     virtual std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) {
         throw RuntimeError("not a function");
     }
+    // marks the object as shared by the forks of a snapshot, see FreezeReachable.
+    // mutable objects refuse changes from then on. the objects it refers to are
+    // appended to children
+    virtual void Freeze(std::vector<Object*>* children) {
+    }
+
+protected:
+    // for objects with static storage duration, which are neither allocated nor counted
+    struct StaticStorage {};
+    constexpr explicit Object(StaticStorage) {
+    }
 };
 
 template <class T>
@@ -24,14 +50,21 @@ bool Is(const std::shared_ptr<Object>& obj);
 template <class T>
 std::shared_ptr<T> As(const std::shared_ptr<Object>& obj);
 
+// builtins are static objects, see builtins.h
 class Func : public Object {
 public:
+    constexpr Func() : Object(StaticStorage{}) {
+    }
+
     virtual std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) {
+        throw RuntimeError("not a function");
     }
 };
 
-class Number : public Object {
+class Number : public Object, private Counted<Number> {
 public:
+    static constexpr ObjectKind kKind = ObjectKind::NUMBER;
+
     Number(const ConstantToken& token) : value_(token.value) {
     }
     int64_t GetValue() const {
@@ -45,24 +78,66 @@ private:
     int64_t value_;
 };
 
-class Symbol : public Object {
+class Symbol : public Object, private Counted<Symbol> {
 public:
-    Symbol(const SymbolToken& token) : name_(token.name) {
+    static constexpr ObjectKind kKind = ObjectKind::SYMBOL;
+
+    Symbol(const SymbolToken& token) : name_(Intern(token.name)), builtin_(FindBuiltin(*name_)) {
+    }
+    // a symbol made at run time, e.g. by string->symbol. its name stays interned only
+    // while symbols of it are alive, unless it is read from the source as well
+    explicit Symbol(std::string_view name)
+        : owned_name_(InternTemporary(name)),
+          name_(owned_name_.get()),
+          builtin_(FindBuiltin(*name_)) {
     }
     const std::string& GetName() const {
+        return *name_;
+    }
+    // symbols with the same name alive at the same time share the same interned
+    // string, so the pointer can be compared and hashed instead of the name
+    const std::string* GetInternedName() const {
         return name_;
     }
+
+    // where the symbol was read, unknown for symbols made at run time
+    SourceSpan GetSpan() const {
+        return span_;
+    }
+    void SetSpan(SourceSpan span) {
+        span_ = span;
+    }
+
     std::shared_ptr<Object> Eval() override {
-        return symbol_map[name_];
+        // user definitions shadow the builtins
+        if (auto env = Environment::GetCurrent()) {
+            if (auto value = env->Find(name_)) {
+                return *value;
+            }
+        }
+        if (!builtin_) {
+            throw RuntimeError(GetName() + " is not defined", span_);
+        }
+        // the builtin is a static object, the pointer doesn't own it
+        return std::shared_ptr<Object>(std::shared_ptr<Object>(), builtin_);
     }
 
+    // the name stays interned until the end of the program
+    static const std::string* Intern(std::string_view name);
+    // the name stays interned while the pointer is alive
+    static std::shared_ptr<const std::string> InternTemporary(std::string_view name);
+
 private:
-    std::string name_;
-    static std::map<std::string, std::shared_ptr<Func>> symbol_map;
+    std::shared_ptr<const std::string> owned_name_;
+    const std::string* name_;
+    Func* builtin_;
+    SourceSpan span_;
 };
 
-class Bool : public Object {
+class Bool : public Object, private Counted<Bool> {
 public:
+    static constexpr ObjectKind kKind = ObjectKind::BOOL;
+
     Bool(const BoolToken& token) {
         if (token == BoolToken::TRUE) {
             state_ = "#t";
@@ -98,8 +173,22 @@ private:
     std::string state_;
 };
 
-class Cell : public Object {
+class Cell : public Object, private Counted<Cell> {
 public:
+    static constexpr ObjectKind kKind = ObjectKind::CELL;
+
+    Cell() = default;
+    // the tail is freed in a loop, so that long lists don't overflow the stack
+    ~Cell() override {
+        while (second_ && second_.use_count() == 1) {
+            auto next = dynamic_cast<Cell*>(second_.get());
+            if (!next) {
+                break;
+            }
+            second_ = std::move(next->second_);
+        }
+    }
+
     std::shared_ptr<Object> GetFirst() const {
         return first_;
     }
@@ -114,19 +203,50 @@ public:
         second_ = other;
     }
 
+    void Freeze(std::vector<Object*>* children) override {
+        children->push_back(first_.get());
+        children->push_back(second_.get());
+    }
+
+    // of the whole list, from the open to the close bracket. only the cells that
+    // start a list in the source have it
+    SourceSpan GetSpan() const {
+        return span_;
+    }
+    void SetSpan(SourceSpan span) {
+        span_ = span;
+    }
+
     std::shared_ptr<Object> Eval() override {
-        if (first_) {
-            auto evalueted = first_->Eval();
-            if (evalueted) {
-                return evalueted->Apply(second_);
+        ConsumeEvalFuel();
+        try {
+            if (first_) {
+                auto evalueted = first_->Eval();
+                if (evalueted) {
+                    SCHEME_PROFILE_SCOPE(GetCalleeName());
+                    ShadowFrame frame{[this] { return GetCalleeName(); }, span_};
+                    return evalueted->Apply(second_);
+                }
             }
+        } catch (SchemeError& error) {
+            // the innermost call with a known span is the one to point at
+            if (!error.span.IsKnown()) {
+                error.span = span_;
+            }
+            throw;
         }
-        throw RuntimeError("cannot evaluate");
+        throw RuntimeError("cannot evaluate", span_);
     }
 
 private:
+    // symbol names are interned, so the pointer stays valid
+    const char* GetCalleeName() const {
+        return Is<Symbol>(first_) ? As<Symbol>(first_)->GetName().c_str() : "<anonymous>";
+    }
+
     std::shared_ptr<Object> first_;
     std::shared_ptr<Object> second_;
+    SourceSpan span_;
 };
 
 template <class T>
@@ -140,21 +260,269 @@ std::shared_ptr<T> As(const std::shared_ptr<Object>& obj) {
 
 template <class T>
 bool Is(const std::shared_ptr<Object>& obj) {
-    if (!obj) {
-        return false;
+    return dynamic_cast<T*>(obj.get()) != nullptr;
+}
+
+class Vector : public Object, private Counted<Vector> {
+public:
+    static constexpr ObjectKind kKind = ObjectKind::VECTOR;
+    // make-vector refuses larger sizes, so that a request can't take all the memory
+    static constexpr int64_t kMaxSize = int64_t{1} << 26;
+
+    // numbers are kept packed in a contiguous int64 buffer, so that the numeric
+    // builtins can run simd kernels over them. the first non number element turns
+    // the vector into a plain array of objects
+    Vector(size_t size, const std::shared_ptr<Object>& fill) {
+        if (!fill || Is<Number>(fill)) {
+            int64_t value = fill ? As<Number>(fill)->GetValue() : 0;
+            packed_elems_.assign(size, value);
+        } else {
+            is_packed_ = false;
+            elems_.assign(size, fill);
+        }
+        TrackBuffers();
     }
-    try {
-        auto ptr = dynamic_cast<T&>(*obj);
-        return true;
-    } catch (const std::bad_cast& e) {
-        return false;
+    Vector(const std::vector<std::shared_ptr<Object>>& elems) {
+        for (auto& el : elems) {
+            if (!Is<Number>(el)) {
+                is_packed_ = false;
+                elems_ = elems;
+                TrackBuffers();
+                return;
+            }
+        }
+        packed_elems_.reserve(elems.size());
+        for (auto& el : elems) {
+            packed_elems_.push_back(As<Number>(el)->GetValue());
+        }
+        TrackBuffers();
     }
-}
+    Vector(std::vector<int64_t> packed_elems) : packed_elems_(std::move(packed_elems)) {
+        TrackBuffers();
+    }
+
+    size_t GetSize() const {
+        return is_packed_ ? packed_elems_.size() : elems_.size();
+    }
+    bool IsPacked() const {
+        return is_packed_;
+    }
+    const std::vector<int64_t>& GetPacked() const {
+        return packed_elems_;
+    }
+
+    std::shared_ptr<Object> Get(size_t i) const {
+        if (i >= GetSize()) {
+            throw RuntimeError("index is out of range");
+        }
+        if (is_packed_) {
+            return std::make_shared<Number>(ConstantToken{packed_elems_[i]});
+        }
+        return elems_[i];
+    }
+    void Set(size_t i, const std::shared_ptr<Object>& value) {
+        if (frozen_) {
+            throw RuntimeError("vector belongs to a snapshot and can't be changed");
+        }
+        if (i >= GetSize()) {
+            throw RuntimeError("index is out of range");
+        }
+        if (is_packed_ && Is<Number>(value)) {
+            packed_elems_[i] = As<Number>(value)->GetValue();
+            return;
+        }
+        Unpack();
+        elems_[i] = value;
+    }
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+    void Freeze(std::vector<Object*>* children) override {
+        if (frozen_) {
+            return;
+        }
+        frozen_ = true;
+        for (auto& el : elems_) {
+            children->push_back(el.get());
+        }
+    }
+
+private:
+    void Unpack() {
+        if (!is_packed_) {
+            return;
+        }
+        elems_.reserve(packed_elems_.size());
+        for (auto value : packed_elems_) {
+            elems_.push_back(std::make_shared<Number>(ConstantToken{value}));
+        }
+        packed_elems_.clear();
+        packed_elems_.shrink_to_fit();
+        is_packed_ = false;
+        TrackBuffers();
+    }
+    void TrackBuffers() {
+        TrackBufferBytes(packed_elems_.capacity() * sizeof(int64_t) +
+                         elems_.capacity() * sizeof(std::shared_ptr<Object>));
+    }
+
+    bool is_packed_ = true;
+    bool frozen_ = false;
+    std::vector<int64_t> packed_elems_;
+    std::vector<std::shared_ptr<Object>> elems_;
+};
+
+class Promise : public Object, private Counted<Promise> {
+public:
+    static constexpr ObjectKind kKind = ObjectKind::PROMISE;
+
+    // the expression is evaluated on the first Force, later calls return the memoized value
+    Promise(const std::shared_ptr<Object>& expr) : expr_(expr) {
+    }
+    // captured are the objects the thunk holds on to, so that Freeze reaches them
+    Promise(std::function<std::shared_ptr<Object>()> thunk,
+            std::vector<std::shared_ptr<Object>> captured)
+        : thunk_(std::move(thunk)), captured_(std::move(captured)) {
+    }
+
+    // no lock is held while the expression is evaluated, so evaluations that force the
+    // promise at the same time each compute it and the first value stays. forcing it
+    // again from inside its own expression throws. a frozen promise keeps no value, it
+    // is computed again by every Force until it was forced before the freeze
+    std::shared_ptr<Object> Force();
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+    void Freeze(std::vector<Object*>* children) override {
+        std::lock_guard lock{mutex_};
+        if (frozen_) {
+            return;
+        }
+        frozen_ = true;
+        children->push_back(expr_.get());
+        children->push_back(value_.get());
+        for (auto& obj : captured_) {
+            children->push_back(obj.get());
+        }
+    }
+
+private:
+    enum class State { UNFORCED, FORCING, FORCED };
+
+    std::mutex mutex_;
+    State state_ = State::UNFORCED;
+    bool frozen_ = false;
+    // the evaluations computing the value, see GetCurrentEvaluation
+    std::vector<const void*> forcers_;
+    std::shared_ptr<Object> expr_;
+    std::function<std::shared_ptr<Object>()> thunk_;
+    std::vector<std::shared_ptr<Object>> captured_;
+    std::shared_ptr<Object> value_;
+};
 
+// the text of a long string, shared with its substrings. it is counted on its own, so
+// that its bytes stay accounted for until the last string that uses it is gone
+class StringBuffer : private Counted<StringBuffer> {
+public:
+    static constexpr ObjectKind kKind = ObjectKind::STRING_BUFFER;
+
+    explicit StringBuffer(std::string_view text) : text_(text) {
+        TrackBufferBytes(text_.capacity() + 1);
+    }
+
+    const std::string& GetText() const {
+        return text_;
+    }
+
+private:
+    std::string text_;
+};
+
+class String : public Object, private Counted<String> {
+public:
+    static constexpr ObjectKind kKind = ObjectKind::STRING;
+    // strings up to this size are kept inside the object, longer ones in a buffer
+    // that their substrings share
+    static constexpr size_t kInlineSize = 16;
+
+    explicit String(std::string_view text) : size_(text.size()) {
+        if (size_ <= kInlineSize) {
+            std::copy(text.begin(), text.end(), inline_);
+        } else {
+            buffer_ = std::make_shared<const StringBuffer>(text);
+            offset_ = 0;
+        }
+    }
+    // the part of the other string, long parts share its buffer
+    String(const String& whole, size_t pos, size_t size) : size_(size) {
+        auto text = whole.GetView().substr(pos, size);
+        if (size_ <= kInlineSize) {
+            std::copy(text.begin(), text.end(), inline_);
+        } else {
+            buffer_ = whole.buffer_;
+            offset_ = whole.offset_ + pos;
+        }
+    }
+
+    std::string_view GetView() const {
+        if (buffer_) {
+            return {buffer_->GetText().data() + offset_, size_};
+        }
+        return {inline_, size_};
+    }
+    size_t GetSize() const {
+        return size_;
+    }
+
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+private:
+    std::shared_ptr<const StringBuffer> buffer_;
+    union {
+        char inline_[kInlineSize];
+        // of the string in the buffer
+        size_t offset_;
+    };
+    size_t size_;
+};
+
+class Char : public Object, private Counted<Char> {
+public:
+    static constexpr ObjectKind kKind = ObjectKind::CHAR;
+
+    Char(const CharToken& token) : value_(token.value) {
+    }
+    char GetValue() const {
+        return value_;
+    }
+    std::shared_ptr<Object> Eval() override {
+        return shared_from_this();
+    }
+
+private:
+    char value_;
+};
+
+// freezes everything reachable from obj, see Object::Freeze. it makes the values of a
+// snapshot safe to share between the forks, which may run on different threads
+void FreezeReachable(const std::shared_ptr<Object>& obj);
+// evaluates an argument of a call, throws on the empty list, which can't be evaluated
+std::shared_ptr<Object> EvalArg(const std::shared_ptr<Object>& arg);
 void GetVector(const std::shared_ptr<Object>& args, std::vector<std::shared_ptr<Object>>& obj);
 void GetRawVector(const std::shared_ptr<Object>& args, std::vector<std::shared_ptr<Object>>& obj);
 std::shared_ptr<Object> GetObjFrowVector(std::vector<std::shared_ptr<Object>>& obj, size_t i);
-std::shared_ptr<Object> MakeArgsForList(std::shared_ptr<Object>& obj);
+// argument list for calling a function on already evaluated values
+std::shared_ptr<Object> MakeArgs(const std::vector<std::shared_ptr<Object>>& values);
+std::shared_ptr<Vector> GetPackedVector(const std::shared_ptr<Object>& obj);
+std::shared_ptr<Object> ForceIfPromise(const std::shared_ptr<Object>& obj);
+std::shared_ptr<Object> MapStream(const std::shared_ptr<Object>& func,
+                                  const std::shared_ptr<Object>& stream);
+std::shared_ptr<Object> FilterStream(const std::shared_ptr<Object>& pred,
+                                     std::shared_ptr<Object> stream);
 
 template <class T>
 bool ValidateObj(std::vector<std::shared_ptr<Object>>& obj) {
@@ -169,7 +537,7 @@ bool ValidateObj(std::vector<std::shared_ptr<Object>>& obj) {
 class IsBool : public Func {
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
         auto cell = As<Cell>(args);
-        auto evalueted = cell->GetFirst()->Eval();
+        auto evalueted = EvalArg(cell->GetFirst());
         if (cell->GetSecond()) {
             throw RuntimeError("wrong cnt of elements");
         }
@@ -210,13 +578,14 @@ class And : public Func {
         if (obj.empty()) {
             return std::make_shared<Bool>(BoolToken::TRUE);
         }
+        std::shared_ptr<Object> eval;
         for (auto& el : obj) {
-            auto eval = el->Eval();
+            eval = EvalArg(el);
             if (Is<Bool>(eval) && !As<Bool>(eval)->IsTrue()) {
                 return std::make_shared<Bool>(BoolToken::FALSE);
             }
         }
-        return obj.back()->Eval();
+        return eval;
     }
 };
 class Or : public Func {
@@ -227,7 +596,7 @@ class Or : public Func {
             return std::make_shared<Bool>(BoolToken::FALSE);
         }
         for (auto& el : obj) {
-            auto eval = el->Eval();
+            auto eval = EvalArg(el);
             if (!Is<Bool>(eval) || As<Bool>(eval)->IsTrue()) {
                 return eval;
             }
@@ -244,6 +613,23 @@ class Quote : public Func {
         return cell->GetFirst();
     }
 };
+class Define : public Func {
+    // binds the value in the environment of the interpreter, returns the name
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetRawVector(args, obj);
+        if (obj.size() != 2 || !Is<Symbol>(obj[0])) {
+            throw SyntaxError("define needs a name and a value");
+        }
+        auto env = Environment::GetCurrent();
+        if (!env) {
+            throw RuntimeError("define outside of an interpreter");
+        }
+        auto value = obj[1] ? obj[1]->Eval() : nullptr;
+        env->Define(As<Symbol>(obj[0])->GetInternedName(), value);
+        return obj[0];
+    }
+};
 class IsPair : public Func {
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
         std::vector<std::shared_ptr<Object>> obj;
@@ -265,14 +651,8 @@ class IsNull : public Func {
         GetVector(args, obj);
         if (obj.size() != 1) {
             return std::make_shared<Bool>(BoolToken::FALSE);
-        } else {
-            std::vector<std::shared_ptr<Object>> elems;
-            GetRawVector(obj[0], elems);
-            if (!elems.empty()) {
-                return std::make_shared<Bool>(BoolToken::FALSE);
-            }
         }
-        return std::make_shared<Bool>(BoolToken::TRUE);
+        return std::make_shared<Bool>(!obj[0]);
     }
 };
 class IsList : public Func {
@@ -282,16 +662,12 @@ class IsList : public Func {
         if (obj.size() != 1) {
             throw RuntimeError("invalid cnt of args");
         }
-        if (!obj[0]) {
-            return std::make_shared<Bool>(BoolToken::TRUE);
-        } else {
-            if (Is<Cell>(obj[0])) {
-                auto sec = As<Cell>(obj[0])->GetSecond();
-                return std::make_shared<IsList>()->Apply(MakeArgsForList(sec));
-            } else {
+        for (auto cur = obj[0]; cur; cur = As<Cell>(cur)->GetSecond()) {
+            if (!Is<Cell>(cur)) {
                 return std::make_shared<Bool>(BoolToken::FALSE);
             }
         }
+        return std::make_shared<Bool>(BoolToken::TRUE);
     }
 };
 class Cons : public Func {
@@ -321,13 +697,11 @@ class Car : public Func {
             if (!eval) {
                 throw RuntimeError("smth is wrong");
             }
-            std::vector<std::shared_ptr<Object>> obj;
-            GetRawVector(eval, obj);
-            if (!obj.empty()) {
-                return obj[0];
-            } else {
-                throw RuntimeError("too few args");
+            // an atom is a list of itself
+            if (!Is<Cell>(eval)) {
+                return eval;
             }
+            return As<Cell>(eval)->GetFirst();
         } else {
             throw NameError("smth is wrong");
         }
@@ -363,10 +737,19 @@ class ListRef : public Func {
         GetVector(args, obj);
         if (obj.size() == 2 && obj[1]) {
             size_t id = As<Number>(obj[1])->GetValue();
-            std::vector<std::shared_ptr<Object>> list;
-            GetRawVector(obj[0], list);
-            if (id < list.size()) {
-                return list[id];
+            // the tail of a dotted list counts as its last element
+            auto cur = obj[0];
+            for (size_t i = 0; cur; ++i) {
+                if (!Is<Cell>(cur)) {
+                    if (i == id) {
+                        return cur;
+                    }
+                    break;
+                }
+                if (i == id) {
+                    return As<Cell>(cur)->GetFirst();
+                }
+                cur = As<Cell>(cur)->GetSecond();
             }
         }
         throw RuntimeError("smth is wrong");
@@ -378,10 +761,14 @@ class ListTail : public Func {
         GetVector(args, obj);
         if (obj.size() == 2 && obj[1]) {
             size_t id = As<Number>(obj[1])->GetValue();
-            std::vector<std::shared_ptr<Object>> list;
-            GetRawVector(obj[0], list);
-            if (id <= list.size()) {
-                return GetObjFrowVector(list, id);
+            // the tail is shared with the list
+            auto cur = obj[0];
+            size_t i = 0;
+            for (; i < id && Is<Cell>(cur); ++i) {
+                cur = As<Cell>(cur)->GetSecond();
+            }
+            if (i == id) {
+                return cur;
             }
         }
         throw RuntimeError("smth is wrong");
@@ -505,15 +892,20 @@ class Sum : public Func {
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
         std::vector<std::shared_ptr<Object>> obj;
         GetVector(args, obj);
+        if (obj.size() == 1 && Is<Vector>(obj[0])) {
+            auto& packed = GetPackedVector(obj[0])->GetPacked();
+            return std::make_shared<Number>(ConstantToken{SimdSum(packed.data(), packed.size())});
+        }
         if (!ValidateObj<Number>(obj)) {
             throw RuntimeError("type of args is not valid");
         }
 
-        int64_t sum = 0;
+        // overflow wraps around, as in the simd kernels and the compiled code
+        uint64_t sum = 0;
         for (auto& el : obj) {
-            sum += As<Number>(el)->GetValue();
+            sum += static_cast<uint64_t>(As<Number>(el)->GetValue());
         }
-        return std::make_shared<Number>(ConstantToken{sum});
+        return std::make_shared<Number>(ConstantToken{static_cast<int64_t>(sum)});
     }
 };
 class Sub : public Func {
@@ -527,11 +919,11 @@ class Sub : public Func {
             throw RuntimeError("cnt of args is not valid");
         }
 
-        int64_t sub = As<Number>(obj[0])->GetValue();
+        uint64_t sub = As<Number>(obj[0])->GetValue();
         for (size_t i = 1; i != obj.size(); ++i) {
-            sub -= As<Number>(obj[i])->GetValue();
+            sub -= static_cast<uint64_t>(As<Number>(obj[i])->GetValue());
         }
-        return std::make_shared<Number>(ConstantToken{sub});
+        return std::make_shared<Number>(ConstantToken{static_cast<int64_t>(sub)});
     }
 };
 class Prod : public Func {
@@ -542,11 +934,11 @@ class Prod : public Func {
             throw RuntimeError("type of args is not valid");
         }
 
-        int64_t prod = 1;
+        uint64_t prod = 1;
         for (auto& el : obj) {
-            prod *= As<Number>(el)->GetValue();
+            prod *= static_cast<uint64_t>(As<Number>(el)->GetValue());
         }
-        return std::make_shared<Number>(ConstantToken{prod});
+        return std::make_shared<Number>(ConstantToken{static_cast<int64_t>(prod)});
     }
 };
 class Div : public Func {
@@ -562,10 +954,12 @@ class Div : public Func {
 
         int64_t mul = As<Number>(obj[0])->GetValue();
         for (size_t i = 1; i != obj.size(); ++i) {
-            if (As<Number>(obj[i])->GetValue() == 0) {
+            int64_t value = As<Number>(obj[i])->GetValue();
+            if (value == 0) {
                 throw RuntimeError("division by zero");
             }
-            mul /= As<Number>(obj[i])->GetValue();
+            // the only quotient that doesn't fit, it wraps around like the other operations
+            mul = value == -1 ? static_cast<int64_t>(0 - static_cast<uint64_t>(mul)) : mul / value;
         }
         return std::make_shared<Number>(ConstantToken{mul});
     }
@@ -574,6 +968,13 @@ class Max : public Func {
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
         std::vector<std::shared_ptr<Object>> obj;
         GetVector(args, obj);
+        if (obj.size() == 1 && Is<Vector>(obj[0])) {
+            auto& packed = GetPackedVector(obj[0])->GetPacked();
+            if (packed.empty()) {
+                throw RuntimeError("cnt of args is not valid");
+            }
+            return std::make_shared<Number>(ConstantToken{SimdMax(packed.data(), packed.size())});
+        }
         if (!ValidateObj<Number>(obj)) {
             throw RuntimeError("type of args is not valid");
         }
@@ -592,6 +993,13 @@ class Min : public Func {
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
         std::vector<std::shared_ptr<Object>> obj;
         GetVector(args, obj);
+        if (obj.size() == 1 && Is<Vector>(obj[0])) {
+            auto& packed = GetPackedVector(obj[0])->GetPacked();
+            if (packed.empty()) {
+                throw RuntimeError("cnt of args is not valid");
+            }
+            return std::make_shared<Number>(ConstantToken{SimdMin(packed.data(), packed.size())});
+        }
         if (!ValidateObj<Number>(obj)) {
             throw RuntimeError("type of args is not valid");
         }
@@ -617,6 +1025,377 @@ class Abs : public Func {
             throw RuntimeError("cnt of args is not valid");
         }
 
-        return std::make_shared<Number>(ConstantToken{std::abs(As<Number>(obj[0])->GetValue())});
+        int64_t value = As<Number>(obj[0])->GetValue();
+        if (value < 0) {
+            value = static_cast<int64_t>(0 - static_cast<uint64_t>(value));
+        }
+        return std::make_shared<Number>(ConstantToken{value});
+    }
+};
+class MakeVector : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.empty() || obj.size() > 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        int64_t size = As<Number>(obj[0])->GetValue();
+        if (size < 0) {
+            throw RuntimeError("size of vector is negative");
+        }
+        if (size > Vector::kMaxSize) {
+            throw RuntimeError("size of vector is too large");
+        }
+        return std::make_shared<Vector>(size, obj.size() == 2 ? obj[1] : nullptr);
+    }
+};
+class VectorLiteral : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        return std::make_shared<Vector>(obj);
+    }
+};
+class VectorRef : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        size_t id = As<Number>(obj[1])->GetValue();
+        return As<Vector>(obj[0])->Get(id);
+    }
+};
+class VectorSet : public Func {
+    // returns the vector itself, so that updates can be chained
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 3) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto vector = As<Vector>(obj[0]);
+        size_t id = As<Number>(obj[1])->GetValue();
+        vector->Set(id, obj[2]);
+        return vector;
+    }
+};
+class VectorLength : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        int64_t size = As<Vector>(obj[0])->GetSize();
+        return std::make_shared<Number>(ConstantToken{size});
+    }
+};
+class VectorSum : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto& packed = GetPackedVector(obj[0])->GetPacked();
+        return std::make_shared<Number>(ConstantToken{SimdSum(packed.data(), packed.size())});
+    }
+};
+class VectorMin : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto& packed = GetPackedVector(obj[0])->GetPacked();
+        if (packed.empty()) {
+            throw RuntimeError("vector is empty");
+        }
+        return std::make_shared<Number>(ConstantToken{SimdMin(packed.data(), packed.size())});
+    }
+};
+class VectorMax : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto& packed = GetPackedVector(obj[0])->GetPacked();
+        if (packed.empty()) {
+            throw RuntimeError("vector is empty");
+        }
+        return std::make_shared<Number>(ConstantToken{SimdMax(packed.data(), packed.size())});
+    }
+};
+class VectorAdd : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto& lhs = GetPackedVector(obj[0])->GetPacked();
+        auto& rhs = GetPackedVector(obj[1])->GetPacked();
+        if (lhs.size() != rhs.size()) {
+            throw RuntimeError("sizes of vectors are different");
+        }
+        std::vector<int64_t> res(lhs.size());
+        SimdAdd(lhs.data(), rhs.data(), res.data(), res.size());
+        return std::make_shared<Vector>(std::move(res));
+    }
+};
+class VectorMul : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto& lhs = GetPackedVector(obj[0])->GetPacked();
+        auto& rhs = GetPackedVector(obj[1])->GetPacked();
+        if (lhs.size() != rhs.size()) {
+            throw RuntimeError("sizes of vectors are different");
+        }
+        std::vector<int64_t> res(lhs.size());
+        SimdMul(lhs.data(), rhs.data(), res.data(), res.size());
+        return std::make_shared<Vector>(std::move(res));
+    }
+};
+class VectorDot : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto& lhs = GetPackedVector(obj[0])->GetPacked();
+        auto& rhs = GetPackedVector(obj[1])->GetPacked();
+        if (lhs.size() != rhs.size()) {
+            throw RuntimeError("sizes of vectors are different");
+        }
+        return std::make_shared<Number>(
+            ConstantToken{SimdDot(lhs.data(), rhs.data(), lhs.size())});
+    }
+};
+class StringLength : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        int64_t size = As<String>(obj[0])->GetSize();
+        return std::make_shared<Number>(ConstantToken{size});
+    }
+};
+class StringRef : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto text = As<String>(obj[0])->GetView();
+        size_t id = As<Number>(obj[1])->GetValue();
+        if (id >= text.size()) {
+            throw RuntimeError("index is out of range");
+        }
+        return std::make_shared<Char>(CharToken{text[id]});
+    }
+};
+class Substring : public Func {
+    // (substring str start [end]), a long result shares the buffer of str
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2 && obj.size() != 3) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto str = As<String>(obj[0]);
+        int64_t start = As<Number>(obj[1])->GetValue();
+        int64_t end = obj.size() == 3 ? As<Number>(obj[2])->GetValue() : str->GetSize();
+        if (start < 0 || start > end || end > static_cast<int64_t>(str->GetSize())) {
+            throw RuntimeError("index is out of range");
+        }
+        return std::make_shared<String>(*str, start, end - start);
+    }
+};
+class StringAppend : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (!ValidateObj<String>(obj)) {
+            throw RuntimeError("type of args is not valid");
+        }
+        if (obj.size() == 1) {
+            return obj[0];
+        }
+        size_t size = 0;
+        for (auto& el : obj) {
+            size += As<String>(el)->GetSize();
+        }
+        std::string text;
+        text.reserve(size);
+        for (auto& el : obj) {
+            text += As<String>(el)->GetView();
+        }
+        return std::make_shared<String>(text);
+    }
+};
+class StringToSymbol : public Func {
+    // the name is interned, so the symbol is the same as the one read from the source,
+    // but only for as long as it is alive: names made up at run time don't pile up
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return std::make_shared<Symbol>(As<String>(obj[0])->GetView());
+    }
+};
+class Delay : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        auto cell = As<Cell>(args);
+        if (cell->GetSecond()) {
+            throw RuntimeError("wrong cnt of elements");
+        }
+        return std::make_shared<Promise>(cell->GetFirst());
+    }
+};
+class Force : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return ForceIfPromise(obj[0]);
+    }
+};
+class ConsStream : public Func {
+    // the head is evaluated right away, the tail is delayed
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetRawVector(args, obj);
+        if (obj.size() != 2 || !obj[0]) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto cell = std::make_shared<Cell>();
+        cell->SetFirst(obj[0]->Eval());
+        cell->SetSecond(std::make_shared<Promise>(obj[1]));
+        return cell;
+    }
+};
+class StreamCar : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return As<Cell>(obj[0])->GetFirst();
+    }
+};
+class StreamCdr : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 1) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return ForceIfPromise(As<Cell>(obj[0])->GetSecond());
+    }
+};
+class StreamTake : public Func {
+    // (stream-take s k): list of the first k elements, or less if the stream is shorter
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        int64_t cnt = As<Number>(obj[1])->GetValue();
+        std::vector<std::shared_ptr<Object>> elems;
+        auto stream = obj[0];
+        for (int64_t i = 0; i < cnt && stream; ++i) {
+            auto cell = As<Cell>(stream);
+            elems.push_back(cell->GetFirst());
+            if (i + 1 < cnt) {
+                stream = ForceIfPromise(cell->GetSecond());
+            }
+        }
+        return GetObjFrowVector(elems, 0);
+    }
+};
+class StreamMap : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return MapStream(obj[0], obj[1]);
+    }
+};
+class StreamFilter : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        std::vector<std::shared_ptr<Object>> obj;
+        GetVector(args, obj);
+        if (obj.size() != 2) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        return FilterStream(obj[0], obj[1]);
+    }
+};
+class ProfileReport : public Func {
+    // list of (name calls total-ns self-ns allocations), the slowest first.
+    // empty unless the interpreter is built with SCHEME_PROFILE
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        if (args) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        std::vector<std::shared_ptr<Object>> rows;
+        for (auto& entry : Profiler::Report()) {
+            std::vector<std::shared_ptr<Object>> row{
+                std::make_shared<Symbol>(SymbolToken{entry.name}),
+                std::make_shared<Number>(ConstantToken{static_cast<int64_t>(entry.calls)}),
+                std::make_shared<Number>(ConstantToken{static_cast<int64_t>(entry.total_ns)}),
+                std::make_shared<Number>(ConstantToken{static_cast<int64_t>(entry.self_ns)}),
+                std::make_shared<Number>(
+                    ConstantToken{static_cast<int64_t>(entry.allocations)})};
+            rows.push_back(GetObjFrowVector(row, 0));
+        }
+        return GetObjFrowVector(rows, 0);
+    }
+};
+class MemoryStatsReport : public Func {
+    // list of (kind live bytes peak-live peak-bytes allocations) for every kind of objects,
+    // followed by (runs cnt allocations) for the calls of Interpreter::Run
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override {
+        if (args) {
+            throw RuntimeError("cnt of args is not valid");
+        }
+        auto stats = MemoryTracker::GetStats();
+        auto number = [](uint64_t value) {
+            return std::make_shared<Number>(ConstantToken{static_cast<int64_t>(value)});
+        };
+        std::vector<std::shared_ptr<Object>> rows;
+        for (auto& kind : stats.kinds) {
+            std::vector<std::shared_ptr<Object>> row{
+                std::make_shared<Symbol>(SymbolToken{kind.name}), number(kind.live),
+                number(kind.bytes), number(kind.peak_live), number(kind.peak_bytes),
+                number(kind.allocations)};
+            rows.push_back(GetObjFrowVector(row, 0));
+        }
+        std::vector<std::shared_ptr<Object>> runs{std::make_shared<Symbol>(SymbolToken{"runs"}),
+                                                  number(stats.runs),
+                                                  number(stats.run_allocations)};
+        rows.push_back(GetObjFrowVector(runs, 0));
+        return GetObjFrowVector(rows, 0);
     }
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "parallel.h"
+#include "thread_pool.h"
+
+namespace {
+
+constexpr size_t kChunksPerThread = 4;
+
+class Sequence {
+public:
+    Sequence(const std::shared_ptr<Object>& seq) {
+        if (Is<Vector>(seq)) {
+            vector_ = As<Vector>(seq);
+        } else if (!seq || Is<Cell>(seq)) {
+            GetRawVector(seq, elems_);
+        } else {
+            throw RuntimeError("type of args is not valid");
+        }
+    }
+
+    size_t GetSize() const {
+        return vector_ ? vector_->GetSize() : elems_.size();
+    }
+    bool IsVector() const {
+        return vector_ != nullptr;
+    }
+    // safe to call from several threads while nobody writes into the vector
+    std::shared_ptr<Object> Get(size_t i) const {
+        return vector_ ? vector_->Get(i) : elems_[i];
+    }
+
+private:
+    std::shared_ptr<Vector> vector_;
+    std::vector<std::shared_ptr<Object>> elems_;
+};
+
+// calls body(chunk, begin, end) for consecutive chunks of [0, size) in parallel
+template <class F>
+size_t ForEachChunk(size_t size, F&& body) {
+    auto& pool = ThreadPool::Global();
+    size_t chunks = std::min(size, pool.GetThreadCount() * kChunksPerThread);
+    pool.ParallelFor(chunks, [&](size_t chunk) {
+        body(chunk, size * chunk / chunks, size * (chunk + 1) / chunks);
+    });
+    return chunks;
+}
+
+std::shared_ptr<Object> Call(const std::shared_ptr<Object>& func,
+                             const std::vector<std::shared_ptr<Object>>& values) {
+    if (!func) {
+        throw RuntimeError("not a function");
+    }
+    return func->Apply(MakeArgs(values));
+}
+
+}  // namespace
+
+std::shared_ptr<Object> ParMap::Apply(const std::shared_ptr<Object>& args) {
+    std::vector<std::shared_ptr<Object>> obj;
+    GetVector(args, obj);
+    if (obj.size() != 2) {
+        throw RuntimeError("cnt of args is not valid");
+    }
+    auto func = obj[0];
+    Sequence seq{obj[1]};
+
+    std::vector<std::shared_ptr<Object>> res(seq.GetSize());
+    ForEachChunk(res.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            res[i] = Call(func, {seq.Get(i)});
+        }
+    });
+
+    if (seq.IsVector()) {
+        return std::make_shared<Vector>(res);
+    }
+    return GetObjFrowVector(res, 0);
+}
+
+std::shared_ptr<Object> ParReduce::Apply(const std::shared_ptr<Object>& args) {
+    std::vector<std::shared_ptr<Object>> obj;
+    GetVector(args, obj);
+    if (obj.size() != 2 && obj.size() != 3) {
+        throw RuntimeError("cnt of args is not valid");
+    }
+    auto func = obj[0];
+    Sequence seq{obj.back()};
+    bool has_init = obj.size() == 3;
+    if (seq.GetSize() == 0) {
+        if (!has_init) {
+            throw RuntimeError("nothing to reduce");
+        }
+        return obj[1];
+    }
+
+    std::vector<std::shared_ptr<Object>> partial(seq.GetSize());
+    size_t chunks = ForEachChunk(seq.GetSize(), [&](size_t chunk, size_t begin, size_t end) {
+        auto acc = seq.Get(begin);
+        for (size_t i = begin + 1; i < end; ++i) {
+            acc = Call(func, {acc, seq.Get(i)});
+        }
+        partial[chunk] = acc;
+    });
+
+    auto acc = has_init ? Call(func, {obj[1], partial[0]}) : partial[0];
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        acc = Call(func, {acc, partial[chunk]});
+    }
+    return acc;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "object.h"
+
+// builtins that split a list or a vector into chunks and process them on the
+// global thread pool. the function must be pure, it is called from several threads
+
+// (par-map f seq): applies f to every element, keeps the order and the kind of seq
+class ParMap : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override;
+};
+
+// (par-reduce f seq) or (par-reduce f init seq): folds every chunk from the left,
+// then folds the results of the chunks in order, so f has to be associative
+class ParReduce : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override;
+};
@@ -1,78 +1,193 @@
 #include "parser.h"
 #include <memory>
+#include <algorithm>
 
-std::shared_ptr<Object> Read(Tokenizer *tokenizer) {
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError("");
+namespace {
+
+// the parser itself, reports errors by returning false and keeping them in error
+class Reader {
+public:
+    explicit Reader(Tokenizer* tokenizer) : tokenizer_(tokenizer) {
+    }
+
+    bool Read(std::shared_ptr<Object>* out) {
+        if (depth_ == kMaxNestingDepth) {
+            return Fail("expression is nested too deeply");
+        }
+        ++depth_;
+        bool res = ReadDatum(out);
+        --depth_;
+        return res;
+    }
+    // the elements are read in a loop, only nested lists take the stack
+    bool ReadList(std::shared_ptr<Object>* out, bool with_close_bracket);
+
+    Diagnostic error;
+
+private:
+    bool Fail(std::string message) {
+        error = {ErrorKind::SYNTAX, std::move(message), tokenizer_->GetSpan()};
+        return false;
+    }
+    bool FailAtEnd() {
+        return tokenizer_->HasError() ? Fail(tokenizer_->GetError()) : Fail("unexpected end");
+    }
+    bool Fail(const Diagnostic& diagnostic) {
+        error = diagnostic;
+        return false;
+    }
+
+    // moves past the current token
+    bool Advance() {
+        end_offset_ = tokenizer_->GetOffset() + tokenizer_->GetSpan().length;
+        return tokenizer_->TryNext() || Fail(tokenizer_->GetError());
+    }
+
+    // from the start of the token with the given span and offset to the last token read
+    SourceSpan SpanFrom(SourceSpan start, size_t start_offset) const {
+        start.length = std::min<size_t>(end_offset_ - start_offset, UINT16_MAX);
+        return start;
+    }
+
+    bool IsCurrent(const Token& token) const {
+        return !tokenizer_->IsEnd() && tokenizer_->GetToken() == token;
+    }
+
+    bool ReadDatum(std::shared_ptr<Object>* out);
+
+    Tokenizer* tokenizer_;
+    size_t end_offset_ = 0;
+    size_t depth_ = 0;
+};
+
+bool Reader::ReadDatum(std::shared_ptr<Object>* out) {
+    // reading a long expression may use up the slice as well
+    ConsumeEvalFuel();
+    if (tokenizer_->IsEnd()) {
+        return FailAtEnd();
+    }
+    auto token = tokenizer_->GetToken();
+    auto span = tokenizer_->GetSpan();
+    auto offset = tokenizer_->GetOffset();
+    if (token == Token{BracketToken::CLOSE}) {
+        return Fail("unexpected ')'");
+    }
+    if (!Advance()) {
+        return false;
     }
-    auto token = tokenizer->GetToken();
-    tokenizer->Next();
 
     if (token == Token{BracketToken::OPEN}) {
-        return ReadList(tokenizer, true);
-    } else if (token == Token{BracketToken::CLOSE}) {
-        throw SyntaxError("");
-    } else if (token == Token{BoolToken::TRUE}) {
-        return std::make_shared<Bool>(std::get<BoolToken>(token));
-    } else if (token == Token{BoolToken::FALSE}) {
-        return std::make_shared<Bool>(std::get<BoolToken>(token));
-    } else if (token == Token{DotToken{}}) {
-        if (tokenizer->IsEnd()) {
-            throw SyntaxError("");
-        } else {
-            return Read(tokenizer);
+        if (!ReadList(out, true)) {
+            return false;
+        }
+        if (*out) {
+            As<Cell>(*out)->SetSpan(SpanFrom(span, offset));
         }
+    } else if (std::holds_alternative<BoolToken>(token)) {
+        *out = std::make_shared<Bool>(std::get<BoolToken>(token));
+    } else if (token == Token{DotToken{}}) {
+        return Read(out);
     } else if (token == Token{QuoteToken{}}) {
-        if (tokenizer->IsEnd()) {
-            throw SyntaxError("");
-        } else {
-            auto cell = std::make_shared<Cell>();
-            cell->SetFirst(std::make_shared<Symbol>(SymbolToken{"quote"}));
-            auto tmp = std::make_shared<Cell>();
-            tmp->SetFirst(Read(tokenizer));
-            tmp->SetSecond(nullptr);
-            cell->SetSecond(tmp);
-            return cell;
+        std::shared_ptr<Object> datum;
+        if (!Read(&datum)) {
+            return false;
         }
+        auto cell = std::make_shared<Cell>();
+        auto quote = std::make_shared<Symbol>(SymbolToken{"quote"});
+        quote->SetSpan(span);
+        cell->SetFirst(quote);
+        auto tmp = std::make_shared<Cell>();
+        tmp->SetFirst(datum);
+        tmp->SetSecond(nullptr);
+        cell->SetSecond(tmp);
+        cell->SetSpan(SpanFrom(span, offset));
+        *out = cell;
+    } else if (std::holds_alternative<SymbolToken>(token)) {
+        auto symbol = std::make_shared<Symbol>(std::get<SymbolToken>(token));
+        symbol->SetSpan(span);
+        *out = symbol;
+    } else if (std::holds_alternative<StringToken>(token)) {
+        *out = std::make_shared<String>(std::get<StringToken>(token).value);
+    } else if (std::holds_alternative<CharToken>(token)) {
+        *out = std::make_shared<Char>(std::get<CharToken>(token));
     } else {
-        if (std::holds_alternative<SymbolToken>(token)) {
-            return std::make_shared<Symbol>(std::get<SymbolToken>(token));
-        } else if (std::holds_alternative<ConstantToken>(token)) {
-            return std::make_shared<Number>(std::get<ConstantToken>(token));
-        }
+        *out = std::make_shared<Number>(std::get<ConstantToken>(token));
     }
+    return true;
 }
-std::shared_ptr<Object> ReadList(Tokenizer *tokenizer, bool with_close_bracket) {
-    auto cell = std::make_shared<Cell>();
-    if (!tokenizer->IsEnd()) {
-        if (tokenizer->GetToken() == Token{DotToken{}}) {
-            throw SyntaxError("dot can't be here");
-        } else if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {  // CLOSE
-            tokenizer->Next();
-            return nullptr;
-        } else {
-            cell->SetFirst(Read(tokenizer));
-            if (tokenizer->GetToken() == Token{DotToken{}}) {
-                cell->SetSecond(Read(tokenizer));
-            } else if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-                cell->SetSecond(nullptr);
-            } else {
-                auto second = ReadList(tokenizer, false);
-                cell->SetSecond(second);
-            }
 
-            if (!with_close_bracket) {
-                return cell;
-            } else if (tokenizer->IsEnd()) {
-                throw SyntaxError("");
-            } else if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-                tokenizer->Next();
-                return cell;
-            } else {
-                throw SyntaxError("");
+bool Reader::ReadList(std::shared_ptr<Object>* out, bool with_close_bracket) {
+    if (tokenizer_->IsEnd()) {
+        return FailAtEnd();
+    }
+    if (IsCurrent(DotToken{})) {
+        return Fail("dot can't be here");
+    }
+    if (IsCurrent(BracketToken::CLOSE)) {
+        *out = nullptr;
+        return Advance();
+    }
+
+    std::shared_ptr<Cell> head;
+    std::shared_ptr<Cell> last;
+    std::shared_ptr<Object> value;
+    while (true) {
+        if (!Read(&value)) {
+            return false;
+        }
+        auto cell = std::make_shared<Cell>();
+        cell->SetFirst(value);
+        if (last) {
+            last->SetSecond(cell);
+        } else {
+            head = cell;
+        }
+        last = cell;
+        if (IsCurrent(DotToken{})) {
+            if (!Read(&value)) {
+                return false;
             }
+            last->SetSecond(value);
+            break;
+        } else if (IsCurrent(BracketToken::CLOSE)) {
+            break;
+        } else if (tokenizer_->IsEnd()) {
+            return FailAtEnd();
         }
+    }
+    *out = head;
+
+    if (!with_close_bracket) {
+        return true;
+    } else if (tokenizer_->IsEnd()) {
+        return FailAtEnd();
+    } else if (IsCurrent(BracketToken::CLOSE)) {
+        return Advance();
     } else {
-        throw SyntaxError("");
+        return Fail("expected ')'");
+    }
+}
+
+}  // namespace
+
+Expected<std::shared_ptr<Object>> TryRead(Tokenizer *tokenizer) {
+    Reader reader{tokenizer};
+    std::shared_ptr<Object> res;
+    if (!reader.Read(&res)) {
+        return reader.error;
+    }
+    return res;
+}
+
+std::shared_ptr<Object> Read(Tokenizer *tokenizer) {
+    return TryRead(tokenizer).ValueOrThrow();
+}
+
+std::shared_ptr<Object> ReadList(Tokenizer *tokenizer, bool with_close_bracket) {
+    Reader reader{tokenizer};
+    std::shared_ptr<Object> res;
+    if (!reader.ReadList(&res, with_close_bracket)) {
+        reader.error.Throw();
     }
+    return res;
 }
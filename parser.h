@@ -6,6 +6,13 @@
 #include "tokenizer.h"
 #include "error.h"
 
+// deeper expressions are rejected, so that reading and evaluating them can't overflow the stack
+constexpr size_t kMaxNestingDepth = 1000;
+
+// reads an expression starting at the current token, throws SyntaxError
 std::shared_ptr<Object> Read(Tokenizer* tokenizer);
 
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer, bool with_close_bracket);
\ No newline at end of file
+std::shared_ptr<Object> ReadList(Tokenizer* tokenizer, bool with_close_bracket);
+
+// the same without exceptions, for input that is expected to be malformed often
+Expected<std::shared_ptr<Object>> TryRead(Tokenizer* tokenizer);
@@ -0,0 +1,170 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+struct Stats {
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t self_ns = 0;
+    uint64_t allocations = 0;
+    // recursive calls add to the total time only once, at the outermost one
+    uint32_t active = 0;
+};
+
+// every thread writes only into its own data, the lock is taken by Report and Reset
+struct ThreadData {
+    std::mutex mutex;
+    std::unordered_map<const char*, Stats> stats;
+    std::vector<ProfileFrame> stack;
+    uint64_t allocations = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // the data outlives its thread, so that the calls of finished threads are reported too
+    std::vector<std::shared_ptr<ThreadData>> threads;
+};
+
+// objects are allocated during static initialization already
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+ThreadData& GetThreadData() {
+    thread_local std::shared_ptr<ThreadData> data = [] {
+        auto data = std::make_shared<ThreadData>();
+        auto& registry = GetRegistry();
+        std::lock_guard lock{registry.mutex};
+        registry.threads.push_back(data);
+        return data;
+    }();
+    return *data;
+}
+
+uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+void Profiler::Enter(const char* name) {
+    auto& data = GetThreadData();
+    std::lock_guard lock{data.mutex};
+    ++data.stats[name].active;
+    data.stack.push_back(ProfileFrame{name, NowNs(), 0, data.allocations, 0});
+}
+
+void Profiler::Leave() {
+    auto& data = GetThreadData();
+    uint64_t now = NowNs();
+    std::lock_guard lock{data.mutex};
+    auto frame = data.stack.back();
+    data.stack.pop_back();
+
+    uint64_t total_ns = now - frame.start_ns;
+    uint64_t allocations = data.allocations - frame.start_allocations;
+    auto& stats = data.stats[frame.name];
+    ++stats.calls;
+    stats.self_ns += total_ns - frame.children_ns;
+    stats.allocations += allocations - frame.children_allocations;
+    if (--stats.active == 0) {
+        stats.total_ns += total_ns;
+    }
+
+    if (!data.stack.empty()) {
+        data.stack.back().children_ns += total_ns;
+        data.stack.back().children_allocations += allocations;
+    }
+}
+
+void Profiler::CountAllocation() {
+    ++GetThreadData().allocations;
+}
+
+size_t Profiler::GetDepth() {
+    auto& data = GetThreadData();
+    std::lock_guard lock{data.mutex};
+    return data.stack.size();
+}
+
+std::vector<ProfileFrame> Profiler::DetachFrames(size_t depth) {
+    auto& data = GetThreadData();
+    std::lock_guard lock{data.mutex};
+    std::vector<ProfileFrame> frames(data.stack.begin() + depth, data.stack.end());
+    data.stack.resize(depth);
+    for (auto& frame : frames) {
+        --data.stats[frame.name].active;
+        // allocation counters are per thread, so only the difference is carried over
+        frame.start_allocations = data.allocations - frame.start_allocations;
+    }
+    return frames;
+}
+
+void Profiler::AttachFrames(std::vector<ProfileFrame> frames) {
+    auto& data = GetThreadData();
+    std::lock_guard lock{data.mutex};
+    for (auto& frame : frames) {
+        ++data.stats[frame.name].active;
+        frame.start_allocations = data.allocations - frame.start_allocations;
+        data.stack.push_back(frame);
+    }
+}
+
+std::vector<ProfileEntry> Profiler::Report() {
+    // the same name may come from different pointers, so the entries are merged by value
+    std::map<std::string, ProfileEntry> merged;
+    {
+        auto& registry = GetRegistry();
+        std::lock_guard registry_lock{registry.mutex};
+        for (auto& data : registry.threads) {
+            std::lock_guard lock{data->mutex};
+            for (auto& [name, stats] : data->stats) {
+                auto& entry = merged[name];
+                entry.calls += stats.calls;
+                entry.total_ns += stats.total_ns;
+                entry.self_ns += stats.self_ns;
+                entry.allocations += stats.allocations;
+            }
+        }
+    }
+
+    std::vector<ProfileEntry> res;
+    for (auto& [name, entry] : merged) {
+        if (entry.calls == 0) {
+            continue;
+        }
+        res.push_back(entry);
+        res.back().name = name;
+    }
+    std::sort(res.begin(), res.end(), [](const ProfileEntry& lhs, const ProfileEntry& rhs) {
+        return lhs.self_ns > rhs.self_ns;
+    });
+    return res;
+}
+
+void Profiler::Reset() {
+    auto& registry = GetRegistry();
+    std::lock_guard registry_lock{registry.mutex};
+    for (auto& data : registry.threads) {
+        std::lock_guard lock{data->mutex};
+        // the calls in progress keep their entries, they are still to be left
+        for (auto it = data->stats.begin(); it != data->stats.end();) {
+            if (it->second.active == 0) {
+                it = data->stats.erase(it);
+            } else {
+                it->second = Stats{0, 0, 0, 0, it->second.active};
+                ++it;
+            }
+        }
+    }
+}
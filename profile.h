@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// per builtin and per phase profiler. it is compiled in only with SCHEME_PROFILE defined
+// (cmake -DSCHEME_PROFILE=ON), otherwise the macros below expand to nothing
+
+struct ProfileEntry {
+    std::string name;
+    uint64_t calls = 0;
+    // time spent in the calls, the nested ones included
+    uint64_t total_ns = 0;
+    // the same without the time of the nested profiled calls
+    uint64_t self_ns = 0;
+    // objects allocated by the calls themselves, not by the nested ones
+    uint64_t allocations = 0;
+};
+
+struct ProfileFrame {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t children_ns;
+    uint64_t start_allocations;
+    uint64_t children_allocations;
+};
+
+class Profiler {
+public:
+    // name must stay alive until the end of the program,
+    // e.g. a literal or an interned symbol name
+    static void Enter(const char* name);
+    static void Leave();
+    static void CountAllocation();
+
+    // an evaluation suspended on one thread and resumed on another takes its open
+    // frames along: detached above the given depth, then attached on the new thread
+    static size_t GetDepth();
+    static std::vector<ProfileFrame> DetachFrames(size_t depth);
+    static void AttachFrames(std::vector<ProfileFrame> frames);
+
+    // merged over all threads, sorted by self time
+    static std::vector<ProfileEntry> Report();
+    static void Reset();
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) {
+        Profiler::Enter(name);
+    }
+    ~ProfileScope() {
+        Profiler::Leave();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#ifdef SCHEME_PROFILE
+#define SCHEME_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SCHEME_PROFILE_CONCAT(a, b) SCHEME_PROFILE_CONCAT_IMPL(a, b)
+#define SCHEME_PROFILE_SCOPE(name) \
+    ProfileScope SCHEME_PROFILE_CONCAT(profile_scope_, __LINE__){name}
+#define SCHEME_PROFILE_ALLOCATION() Profiler::CountAllocation()
+#else
+#define SCHEME_PROFILE_SCOPE(name)
+#define SCHEME_PROFILE_ALLOCATION()
+#endif
@@ -0,0 +1,219 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// the span packed into one word, so that a frame is two atomic stores
+uint64_t PackSpan(SourceSpan span) {
+    return static_cast<uint64_t>(span.line) << 32 | static_cast<uint64_t>(span.column) << 16 |
+           span.length;
+}
+
+SourceSpan UnpackSpan(uint64_t packed) {
+    return {static_cast<uint32_t>(packed >> 32), static_cast<uint16_t>(packed >> 16),
+            static_cast<uint16_t>(packed)};
+}
+
+struct ThreadFrame {
+    std::atomic<const char*> name = nullptr;
+    std::atomic<uint64_t> span = 0;
+};
+
+// written only by its own thread, read by the sampler. a sample may see a frame
+// that has just been replaced, even the name of one and the span of the other, but
+// every pointer in it is a valid name
+struct ThreadStack {
+    std::atomic<size_t> depth = 0;
+    ThreadFrame frames[ShadowStack::kMaxDepth];
+};
+
+struct Sampler {
+    std::mutex mutex;
+    std::vector<ThreadStack*> stacks;
+    std::map<std::string, uint64_t> counts;
+
+    std::thread thread;
+    std::condition_variable wake;
+    bool running = false;
+};
+
+// never destroyed: threads of static pools unregister their stacks when they exit,
+// which may be after the static destructors of this file
+Sampler& GetSampler() {
+    static Sampler& sampler = *new Sampler;
+    return sampler;
+}
+
+// SampledRequests the thread is inside of
+thread_local size_t sampled_requests = 0;
+
+// the stack of the thread, nullptr until it pushes a frame
+thread_local ThreadStack* thread_stack = nullptr;
+
+// registered from the first pushed frame while the thread is alive, so threads that
+// are never sampled don't show up in the sampler
+struct ThreadStackHolder {
+    ThreadStackHolder() {
+        auto& sampler = GetSampler();
+        std::lock_guard lock{sampler.mutex};
+        sampler.stacks.push_back(&stack);
+        thread_stack = &stack;
+    }
+    ~ThreadStackHolder() {
+        thread_stack = nullptr;
+        auto& sampler = GetSampler();
+        std::lock_guard lock{sampler.mutex};
+        sampler.stacks.erase(std::find(sampler.stacks.begin(), sampler.stacks.end(), &stack));
+    }
+
+    ThreadStack stack;
+};
+
+ThreadStack& GetThreadStack() {
+    thread_local ThreadStackHolder holder;
+    return holder.stack;
+}
+
+void TakeSample(Sampler& sampler) {
+    for (auto stack : sampler.stacks) {
+        size_t depth = std::min(stack->depth.load(std::memory_order_acquire),
+                                ShadowStack::kMaxDepth);
+        if (depth == 0) {
+            continue;
+        }
+        std::string folded;
+        for (size_t i = 0; i < depth; ++i) {
+            if (i) {
+                folded += ';';
+            }
+            auto& frame = stack->frames[i];
+            folded += frame.name.load(std::memory_order_relaxed);
+            auto span = UnpackSpan(frame.span.load(std::memory_order_relaxed));
+            if (span.IsKnown()) {
+                folded += '@' + span.ToString();
+            }
+        }
+        ++sampler.counts[folded];
+    }
+}
+
+void SamplerLoop(std::chrono::microseconds interval) {
+    auto& sampler = GetSampler();
+    std::unique_lock lock{sampler.mutex};
+    while (sampler.running) {
+        if (sampler.wake.wait_for(lock, interval, [&] { return !sampler.running; })) {
+            break;
+        }
+        TakeSample(sampler);
+    }
+}
+
+}  // namespace
+
+bool ShadowStack::IsEnabled() {
+    return sampled_requests > 0;
+}
+
+void ShadowStack::Push(const char* name, SourceSpan span) {
+    auto& stack = GetThreadStack();
+    size_t depth = stack.depth.load(std::memory_order_relaxed);
+    if (depth < kMaxDepth) {
+        stack.frames[depth].name.store(name, std::memory_order_relaxed);
+        stack.frames[depth].span.store(PackSpan(span), std::memory_order_relaxed);
+    }
+    stack.depth.store(depth + 1, std::memory_order_release);
+}
+
+void ShadowStack::Pop() {
+    auto& stack = GetThreadStack();
+    stack.depth.store(stack.depth.load(std::memory_order_relaxed) - 1,
+                      std::memory_order_release);
+}
+
+size_t ShadowStack::GetDepth() {
+    return thread_stack ? thread_stack->depth.load(std::memory_order_relaxed) : 0;
+}
+
+std::vector<ShadowStack::Frame> ShadowStack::DetachFrames(size_t depth) {
+    if (GetDepth() == depth) {
+        return {};
+    }
+    auto& stack = *thread_stack;
+    size_t top = stack.depth.load(std::memory_order_relaxed);
+    std::vector<Frame> frames;
+    frames.reserve(top - depth);
+    for (size_t i = depth; i < top; ++i) {
+        if (i < kMaxDepth) {
+            auto& frame = stack.frames[i];
+            frames.push_back({frame.name.load(std::memory_order_relaxed),
+                              UnpackSpan(frame.span.load(std::memory_order_relaxed))});
+        } else {
+            // was not recorded, but may be after the move to a shallower stack
+            frames.push_back({"<unknown>", {}});
+        }
+    }
+    stack.depth.store(depth, std::memory_order_release);
+    return frames;
+}
+
+void ShadowStack::AttachFrames(const std::vector<Frame>& frames) {
+    for (auto& frame : frames) {
+        Push(frame.name, frame.span);
+    }
+}
+
+size_t ShadowStack::ExchangeSampledRequests(size_t count) {
+    return std::exchange(sampled_requests, count);
+}
+
+SampledRequest::SampledRequest() {
+    ++sampled_requests;
+}
+
+SampledRequest::~SampledRequest() {
+    --sampled_requests;
+}
+
+void SamplingProfiler::Start(std::chrono::microseconds interval) {
+    Stop();
+    auto& sampler = GetSampler();
+    std::lock_guard lock{sampler.mutex};
+    sampler.running = true;
+    sampler.thread = std::thread(SamplerLoop, std::max(interval, kMinInterval));
+}
+
+void SamplingProfiler::Stop() {
+    auto& sampler = GetSampler();
+    {
+        std::lock_guard lock{sampler.mutex};
+        if (!sampler.running) {
+            return;
+        }
+        sampler.running = false;
+    }
+    sampler.wake.notify_all();
+    sampler.thread.join();
+}
+
+void SamplingProfiler::WriteFolded(std::ostream& out) {
+    auto& sampler = GetSampler();
+    std::lock_guard lock{sampler.mutex};
+    for (auto& [stack, count] : sampler.counts) {
+        out << stack << ' ' << count << '\n';
+    }
+}
+
+void SamplingProfiler::Reset() {
+    auto& sampler = GetSampler();
+    std::lock_guard lock{sampler.mutex};
+    sampler.counts.clear();
+}
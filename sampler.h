@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+#include "error.h"
+
+// sampling profiler over a shadow stack of scheme calls.
+//
+// a thread keeps its shadow stack only while it is inside a SampledRequest, so that
+// sampling can be turned on for a fraction of the requests and the rest pay for one
+// check per call. while the sampler runs, a background thread periodically copies the
+// stacks of all sampled threads and counts them, the result is written in the folded
+// format of flamegraph.pl: "outer;inner;innermost count" per line. a frame is the name
+// of the callee and the position of the call in the source, e.g. "vector-sum@3:14",
+// or the name alone when the position is unknown
+
+class ShadowStack {
+public:
+    // frames deeper than this are counted but not recorded
+    static constexpr size_t kMaxDepth = 256;
+
+    struct Frame {
+        const char* name;
+        SourceSpan span;
+    };
+
+    static bool IsEnabled();
+    // name must stay alive until the end of the program,
+    // e.g. a literal or an interned symbol name
+    static void Push(const char* name, SourceSpan span);
+    static void Pop();
+
+    // for evaluations that move between threads, see Scheduler: the frames above depth
+    // are taken off the stack of the thread and pushed back on the thread that resumes it
+    static size_t GetDepth();
+    static std::vector<Frame> DetachFrames(size_t depth);
+    static void AttachFrames(const std::vector<Frame>& frames);
+    // replaces the count of the SampledRequests of the thread, returns the old value
+    static size_t ExchangeSampledRequests(size_t count);
+};
+
+class ShadowFrame {
+public:
+    // get_name is called only when the frame is really pushed
+    template <class F>
+    ShadowFrame(F&& get_name, SourceSpan span) : pushed_(ShadowStack::IsEnabled()) {
+        if (pushed_) {
+            ShadowStack::Push(get_name(), span);
+        }
+    }
+    ~ShadowFrame() {
+        if (pushed_) {
+            ShadowStack::Pop();
+        }
+    }
+
+    ShadowFrame(const ShadowFrame&) = delete;
+    ShadowFrame& operator=(const ShadowFrame&) = delete;
+
+private:
+    bool pushed_;
+};
+
+// enables the shadow stack of the current thread for its lifetime, may be nested
+class SampledRequest {
+public:
+    SampledRequest();
+    ~SampledRequest();
+
+    SampledRequest(const SampledRequest&) = delete;
+    SampledRequest& operator=(const SampledRequest&) = delete;
+};
+
+class SamplingProfiler {
+public:
+    static constexpr std::chrono::microseconds kMinInterval{100};
+
+    // intervals below kMinInterval are raised to it, which bounds the overhead
+    static void Start(std::chrono::microseconds interval = std::chrono::milliseconds(1));
+    static void Stop();
+
+    static void WriteFolded(std::ostream& out);
+    static void Reset();
+};
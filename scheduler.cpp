@@ -0,0 +1,265 @@
+#include "scheduler.h"
+#include "scheme.h"
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <optional>
+
+struct SchedulerTask {
+    std::string expr;
+    InterpreterSnapshot base;
+    bool sampled = false;
+    std::promise<Expected<std::string>> result;
+
+    ucontext_t context;
+    // context of the worker running the task at the moment
+    ucontext_t* worker_context = nullptr;
+    char* stack = nullptr;
+    size_t stack_size = 0;
+    bool started = false;
+    bool finished = false;
+
+    // the environment of the interpreter, swapped in while the task runs
+    Environment* env = nullptr;
+
+    int64_t steps_left = 0;
+    // objects allocated by the evaluation, swapped into the thread counter while it runs
+    uint64_t allocations = 0;
+    uint64_t allocation_limit = 0;
+    int non_preemptible = 0;
+
+    // the shadow frames of the sampler pushed by the task, kept while it is suspended,
+    // and its SampledRequests, swapped into the thread count while it runs
+    size_t shadow_base = 0;
+    std::vector<ShadowStack::Frame> shadow_frames;
+    size_t sampled_requests = 0;
+
+#ifdef SCHEME_PROFILE
+    size_t profile_base = 0;
+    std::vector<ProfileFrame> profile_frames;
+#endif
+};
+
+namespace {
+
+// the task running on this thread. thread locals are read only before switching
+// the context, a resumed fiber may be on another thread already
+thread_local SchedulerTask* current_task = nullptr;
+
+void Suspend(SchedulerTask* task) {
+    task->shadow_frames = ShadowStack::DetachFrames(task->shadow_base);
+#ifdef SCHEME_PROFILE
+    task->profile_frames = Profiler::DetachFrames(task->profile_base);
+#endif
+    swapcontext(&task->context, task->worker_context);
+}
+
+void RunTask(SchedulerTask* task) {
+    try {
+        std::optional<SampledRequest> sampled;
+        if (task->sampled) {
+            sampled.emplace();
+        }
+        Interpreter interpreter{std::move(task->base)};
+        task->result.set_value(interpreter.TryRun(task->expr));
+    } catch (...) {
+        task->result.set_exception(std::current_exception());
+    }
+    task->finished = true;
+}
+
+// makecontext passes int arguments only, so the pointer comes in two halves
+void TaskEntry(unsigned int high, unsigned int low) {
+    auto task = reinterpret_cast<SchedulerTask*>((static_cast<uintptr_t>(high) << 32) | low);
+    RunTask(task);
+    setcontext(task->worker_context);
+}
+
+size_t GetMappingSize(size_t stack_size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    return (stack_size + page - 1) / page * page + page;
+}
+
+char* AllocateStack(size_t stack_size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = GetMappingSize(stack_size);
+    void* stack = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        throw std::runtime_error("cannot allocate the stack of a task");
+    }
+    // the lowest page stays unmapped, so that an overflow crashes instead of
+    // overwriting the neighbour
+    mprotect(stack, page, PROT_NONE);
+    return static_cast<char*>(stack);
+}
+
+}  // namespace
+
+void ConsumeEvalFuel() {
+    auto task = current_task;
+    if (!task) {
+        return;
+    }
+    if (--task->steps_left > 0 && MemoryTracker::GetThreadAllocations() < task->allocation_limit) {
+        return;
+    }
+    if (task->non_preemptible == 0) {
+        Suspend(task);
+    }
+}
+
+const void* GetCurrentEvaluation() {
+    thread_local char thread_marker;
+    if (current_task) {
+        return current_task;
+    }
+    return &thread_marker;
+}
+
+NonPreemptibleScope::NonPreemptibleScope() {
+    if (current_task) {
+        ++current_task->non_preemptible;
+    }
+}
+
+NonPreemptibleScope::~NonPreemptibleScope() {
+    if (current_task) {
+        --current_task->non_preemptible;
+    }
+}
+
+void Scheduler::StartTask(SchedulerTask* task) {
+    {
+        std::lock_guard lock{mutex_};
+        if (!stack_cache_.empty()) {
+            task->stack = stack_cache_.back();
+            stack_cache_.pop_back();
+        }
+    }
+    if (!task->stack) {
+        task->stack = AllocateStack(stack_size_);
+    }
+    task->stack_size = GetMappingSize(stack_size_);
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = task->stack_size;
+    task->context.uc_link = nullptr;
+    auto ptr = reinterpret_cast<uintptr_t>(task);
+    makecontext(&task->context, reinterpret_cast<void (*)()>(TaskEntry), 2,
+                static_cast<unsigned int>(ptr >> 32), static_cast<unsigned int>(ptr));
+    task->started = true;
+}
+
+void Scheduler::DestroyTask(SchedulerTask* task) {
+    if (task->stack) {
+        std::unique_lock lock{mutex_};
+        if (stack_cache_.size() < kStackCacheSize) {
+            stack_cache_.push_back(task->stack);
+        } else {
+            lock.unlock();
+            munmap(task->stack, task->stack_size);
+        }
+    }
+    delete task;
+}
+
+Scheduler::Scheduler(size_t threads, EvalBudget slice, size_t stack_size)
+    : slice_(slice), stack_size_(stack_size) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    for (auto stack : stack_cache_) {
+        munmap(stack, GetMappingSize(stack_size_));
+    }
+}
+
+std::future<Expected<std::string>> Scheduler::Submit(std::string expr) {
+    return Submit(std::move(expr), nullptr);
+}
+
+std::future<Expected<std::string>> Scheduler::Submit(std::string expr,
+                                                     std::shared_ptr<const Environment> base,
+                                                     bool sampled) {
+    auto task = new SchedulerTask;
+    task->expr = std::move(expr);
+    task->base = std::move(base);
+    task->sampled = sampled;
+    auto res = task->result.get_future();
+    {
+        std::lock_guard lock{mutex_};
+        ++alive_;
+        queue_.push_back(task);
+    }
+    ready_.notify_one();
+    return res;
+}
+
+void Scheduler::WorkerLoop() {
+    ucontext_t worker_context;
+    while (true) {
+        SchedulerTask* task;
+        {
+            std::unique_lock lock{mutex_};
+            ready_.wait(lock, [this] { return !queue_.empty() || (stop_ && alive_ == 0); });
+            if (queue_.empty()) {
+                return;
+            }
+            task = queue_.front();
+            queue_.pop_front();
+        }
+
+        if (!task->started) {
+            try {
+                StartTask(task);
+            } catch (...) {
+                task->result.set_exception(std::current_exception());
+                task->finished = true;
+            }
+        }
+        if (!task->finished) {
+            task->worker_context = &worker_context;
+            task->steps_left = slice_.steps;
+            task->allocation_limit = task->allocations + slice_.allocations;
+            auto worker_allocations = MemoryTracker::ExchangeThreadAllocations(task->allocations);
+            auto worker_env = Environment::Exchange(task->env);
+            auto worker_sampled = ShadowStack::ExchangeSampledRequests(task->sampled_requests);
+            current_task = task;
+            task->shadow_base = ShadowStack::GetDepth();
+            ShadowStack::AttachFrames(task->shadow_frames);
+#ifdef SCHEME_PROFILE
+            task->profile_base = Profiler::GetDepth();
+            Profiler::AttachFrames(std::move(task->profile_frames));
+#endif
+            swapcontext(&worker_context, &task->context);
+            current_task = nullptr;
+            task->allocations = MemoryTracker::ExchangeThreadAllocations(worker_allocations);
+            task->env = Environment::Exchange(worker_env);
+            task->sampled_requests = ShadowStack::ExchangeSampledRequests(worker_sampled);
+        }
+
+        if (task->finished) {
+            DestroyTask(task);
+            std::lock_guard lock{mutex_};
+            if (--alive_ == 0) {
+                ready_.notify_all();
+            }
+        } else {
+            std::lock_guard lock{mutex_};
+            queue_.push_back(task);
+        }
+    }
+}
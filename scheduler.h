@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+
+// cooperative scheduling of evaluations.
+//
+// every submitted expression is evaluated on its own fiber. it gets a budget of
+// evaluation steps and object allocations per time slice, checked on every call in
+// Cell::Eval; when the budget runs out the fiber is suspended and put at the end of the
+// run queue, so a long evaluation delays the others by at most one slice at a time.
+// a fixed pool of worker threads resumes the fibers, a fiber may move between them
+
+struct EvalBudget {
+    int64_t steps = 10000;
+    uint64_t allocations = 100000;
+};
+
+// called on every evaluation step, suspends the current evaluation when it has used
+// up its slice. does nothing outside of the scheduler
+void ConsumeEvalFuel();
+
+// identifies the evaluation running on this thread: its task inside the scheduler, the
+// thread itself outside of it
+const void* GetCurrentEvaluation();
+
+// evaluation inside the scope is never suspended, for code that must stay on its thread
+class NonPreemptibleScope {
+public:
+    NonPreemptibleScope();
+    ~NonPreemptibleScope();
+
+    NonPreemptibleScope(const NonPreemptibleScope&) = delete;
+    NonPreemptibleScope& operator=(const NonPreemptibleScope&) = delete;
+};
+
+struct SchedulerTask;
+class Environment;
+
+class Scheduler {
+public:
+    static constexpr size_t kDefaultStackSize = 8 << 20;
+    // stacks of finished evaluations kept for the next ones
+    static constexpr size_t kStackCacheSize = 64;
+
+    explicit Scheduler(size_t threads, EvalBudget slice = {},
+                       size_t stack_size = kDefaultStackSize);
+    // waits until all submitted evaluations are finished
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // the future holds the printed result or the error of the evaluation, see
+    // Interpreter::TryRun. it has an exception only when the evaluation couldn't start
+    std::future<Expected<std::string>> Submit(std::string expr);
+    // evaluates in a fork of the snapshot of an interpreter, see Interpreter::Snapshot.
+    // a sampled evaluation runs inside a SampledRequest, see SamplingProfiler
+    std::future<Expected<std::string>> Submit(std::string expr,
+                                              std::shared_ptr<const Environment> base,
+                                              bool sampled = false);
+
+private:
+    void WorkerLoop();
+    void StartTask(SchedulerTask* task);
+    void DestroyTask(SchedulerTask* task);
+
+    EvalBudget slice_;
+    size_t stack_size_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<SchedulerTask*> queue_;
+    std::vector<char*> stack_cache_;
+    size_t alive_ = 0;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
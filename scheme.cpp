@@ -1,16 +1,64 @@
 #include "scheme.h"
+#include "hash_table.h"
+#include "aot.h"
+#include <cstdio>
 #include <sstream>
 
-std::shared_ptr<Object> ReadFullString(const std::string& str) {
+Expected<std::shared_ptr<Object>> TryReadFullString(const std::string& str) {
     std::stringstream ss{str};
     Tokenizer tokenizer{&ss};
-    auto res = Read(&tokenizer);
-    if (!tokenizer.IsEnd()) {
-        throw SyntaxError("syntax error");
+    auto res = TryRead(&tokenizer);
+    if (res && !tokenizer.IsEnd()) {
+        return Diagnostic{ErrorKind::SYNTAX, "unexpected token after the expression",
+                          tokenizer.GetSpan()};
     }
     return res;
 }
 
+std::shared_ptr<Object> ReadFullString(const std::string& str) {
+    return TryReadFullString(str).ValueOrThrow();
+}
+
+namespace {
+
+// the literal that reads back as the same string
+std::string QuoteString(std::string_view text) {
+    std::string res = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            res += '\\';
+            res += ch;
+        } else if (ch == '\n') {
+            res += "\\n";
+        } else if (ch == '\t') {
+            res += "\\t";
+        } else if (ch == '\r') {
+            res += "\\r";
+        } else if (static_cast<unsigned char>(ch) < ' ' || ch == '\x7f') {
+            // the other control characters, so that the output stays text
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\x%x;", static_cast<unsigned char>(ch));
+            res += escape;
+        } else {
+            res += ch;
+        }
+    }
+    return res + '"';
+}
+
+std::string CharLiteral(char ch) {
+    if (ch == ' ') {
+        return "#\\space";
+    } else if (ch == '\n') {
+        return "#\\newline";
+    } else if (ch == '\t') {
+        return "#\\tab";
+    }
+    return std::string("#\\") + ch;
+}
+
+}  // namespace
+
 std::string RepresentAsStr(const std::shared_ptr<Object>& obj, bool brackets) {
     std::string s;
     auto cur = obj;
@@ -22,18 +70,43 @@ std::string RepresentAsStr(const std::shared_ptr<Object>& obj, bool brackets) {
         return As<Symbol>(cur)->GetName();
     } else if (Is<Bool>(cur)) {
         return As<Bool>(cur)->GetState();
+    } else if (Is<Vector>(cur)) {
+        auto vector = As<Vector>(cur);
+        s += "#(";
+        for (size_t i = 0; i < vector->GetSize(); ++i) {
+            if (i) {
+                s += ' ';
+            }
+            s += RepresentAsStr(vector->Get(i), true);
+        }
+        s += ')';
+        return s;
+    } else if (Is<String>(cur)) {
+        return QuoteString(As<String>(cur)->GetView());
+    } else if (Is<Char>(cur)) {
+        return CharLiteral(As<Char>(cur)->GetValue());
+    } else if (Is<Promise>(cur)) {
+        return "#<promise>";
+    } else if (Is<HashTable>(cur)) {
+        return "#<hash-table:" + std::to_string(As<HashTable>(cur)->GetSize()) + ">";
     } else {
         if (brackets) {
             s += '(';
         }
-        auto cell = As<Cell>(cur);
-        s += RepresentAsStr(cell->GetFirst(), true);
-        if (cell->GetSecond()) {
+        // the spine is walked in a loop, only nested lists recurse
+        while (true) {
+            auto cell = As<Cell>(cur);
+            s += RepresentAsStr(cell->GetFirst(), true);
+            cur = cell->GetSecond();
+            if (!cur) {
+                break;
+            }
             s += ' ';
-            if (!Is<Cell>(cell->GetSecond())) {
+            if (!Is<Cell>(cur)) {
                 s += ". ";
+                s += RepresentAsStr(cur, false);
+                break;
             }
-            s += RepresentAsStr(cell->GetSecond(), false);
         }
         if (brackets) {
             s += ')';
@@ -42,11 +115,64 @@ std::string RepresentAsStr(const std::shared_ptr<Object>& obj, bool brackets) {
     return s;
 }
 
+namespace {
+
+class RunAllocationCounter {
+public:
+    RunAllocationCounter(uint64_t* last_run_allocations)
+        : last_run_allocations_(last_run_allocations),
+          start_(MemoryTracker::GetThreadAllocations()) {
+    }
+    ~RunAllocationCounter() {
+        *last_run_allocations_ = MemoryTracker::GetThreadAllocations() - start_;
+        MemoryTracker::RecordRun(*last_run_allocations_);
+    }
+
+private:
+    uint64_t* last_run_allocations_;
+    uint64_t start_;
+};
+
+}  // namespace
+
 std::string Interpreter::Run(std::string& expr) {
-    auto obj = ReadFullString(expr);
+    return TryRun(expr).ValueOrThrow();
+}
+
+Expected<std::string> Interpreter::TryRun(const std::string& expr) {
+    RunAllocationCounter allocation_counter{&last_run_allocations_};
+    EnvironmentScope env_scope{&env_};
+    auto obj = [&] {
+        SCHEME_PROFILE_SCOPE("<read>");
+        return TryReadFullString(expr);
+    }();
     if (!obj) {
-        throw RuntimeError("this is void");
+        return obj.GetError();
+    }
+    if (!obj.GetValue()) {
+        return Diagnostic{ErrorKind::RUNTIME, "this is void", {}};
+    }
+    try {
+        std::shared_ptr<Object> res;
+        {
+            SCHEME_PROFILE_SCOPE("<eval>");
+            res = obj.GetValue()->Eval();
+        }
+        SCHEME_PROFILE_SCOPE("<print>");
+        return RepresentAsStr(res, true);
+    } catch (const SchemeError& error) {
+        return Diagnostic::FromError(error);
+    }
+}
+
+std::string Interpreter::RunCompiled(const AotModule& module, size_t entry) {
+    RunAllocationCounter allocation_counter{&last_run_allocations_};
+    EnvironmentScope env_scope{&env_};
+    std::shared_ptr<Object> res;
+    {
+        SCHEME_PROFILE_SCOPE("<eval>");
+        res = module.Eval(entry);
     }
-    auto res = obj->Eval();
+    SCHEME_PROFILE_SCOPE("<print>");
     return RepresentAsStr(res, true);
 }
@@ -5,11 +5,46 @@
 
 #include <string>
 
+class AotModule;
+
 std::shared_ptr<Object> ReadFullString(const std::string& str);
+// the same without exceptions
+Expected<std::shared_ptr<Object>> TryReadFullString(const std::string& str);
+
+// the frozen environment of an interpreter, any number of forks may share it
+using InterpreterSnapshot = std::shared_ptr<const Environment>;
 
 class Interpreter {
 public:
+    Interpreter() = default;
+    // a fork of the snapshot, its definitions stay local to it
+    explicit Interpreter(InterpreterSnapshot snapshot) : env_(std::move(snapshot)) {
+    }
+
     std::string Run(std::string& expr);
+    // the same, but the error comes back instead of being thrown. malformed input is
+    // rejected without any exception, errors of the evaluation are caught at the boundary
+    Expected<std::string> TryRun(const std::string& expr);
+    // the same for an entry of a compiled module, see aot.h
+    std::string RunCompiled(const AotModule& module, size_t entry);
+
+    // definitions made after the snapshot don't change it. the vectors and hash tables
+    // defined before it can't be changed anymore, neither here nor in the forks
+    InterpreterSnapshot Snapshot() {
+        return env_.Freeze();
+    }
+    Interpreter Fork() {
+        return Interpreter{Snapshot()};
+    }
+
+    // objects allocated on the calling thread by the last Run
+    uint64_t GetLastRunAllocations() const {
+        return last_run_allocations_;
+    }
+
+private:
+    Environment env_;
+    uint64_t last_run_allocations_ = 0;
 };
 
-std::string RepresentAsStr(const std::shared_ptr<Object>& obj);
+std::string RepresentAsStr(const std::shared_ptr<Object>& obj, bool brackets = true);
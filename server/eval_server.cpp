@@ -0,0 +1,225 @@
+#include "eval_server.h"
+#include "error.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kReadSize = 1 << 16;
+constexpr int kAcceptPollMs = 100;
+
+uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool WriteAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t res = write(fd, data.data() + written, data.size() - written);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        written += res;
+    }
+    return true;
+}
+
+std::string Describe(const char* kind, const std::exception& error) {
+    std::string res = "error ";
+    res += kind;
+    if (*error.what()) {
+        res += ": ";
+        res += error.what();
+    }
+    return res;
+}
+
+// e.g. "error syntax at 1:7: unexpected ')'"
+std::string Describe(const Diagnostic& error) {
+    std::string res = "error ";
+    res += error.GetKindName();
+    if (error.span.IsKnown()) {
+        res += " at " + error.span.ToString();
+    }
+    if (!error.message.empty()) {
+        res += ": " + error.message;
+    }
+    return res;
+}
+
+// the payload of the response, true when it is an error
+bool AwaitResponse(std::future<Expected<std::string>>& result, std::string* payload) {
+    try {
+        auto res = result.get();
+        if (res) {
+            *payload = "ok " + res.GetValue();
+            return false;
+        }
+        *payload = Describe(res.GetError());
+    } catch (const std::exception& error) {
+        *payload = Describe("internal", error);
+    }
+    return true;
+}
+
+}  // namespace
+
+ServerMetrics::ServerMetrics() : start_(std::chrono::steady_clock::now()) {
+}
+
+void ServerMetrics::Record(uint64_t latency_ns, bool error) {
+    std::lock_guard lock{mutex_};
+    latencies_.Record(latency_ns);
+    errors_ += error;
+}
+
+std::string ServerMetrics::Report() const {
+    std::lock_guard lock{mutex_};
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "requests %llu, errors %llu, %.1f req/s, p50 %.1f us, p99 %.1f us, max %.1f us",
+                  static_cast<unsigned long long>(latencies_.GetCount()),
+                  static_cast<unsigned long long>(errors_), latencies_.GetCount() / seconds,
+                  latencies_.GetPercentile(0.5) / 1e3, latencies_.GetPercentile(0.99) / 1e3,
+                  latencies_.GetMax() / 1e3);
+    return buf;
+}
+
+EvalServer::EvalServer(ServerOptions options)
+    : options_(options), scheduler_(options.threads, options.slice) {
+}
+
+void EvalServer::ServeStream(int in_fd, int out_fd) {
+    struct Pending {
+        uint64_t start_ns;
+        std::future<Expected<std::string>> result;
+    };
+
+    FrameReader reader{options_.framing};
+    std::vector<char> buf(kReadSize);
+    std::vector<Pending> batch;
+    std::string frame;
+    std::string out;
+    while (!stop_.load()) {
+        ssize_t size = read(in_fd, buf.data(), buf.size());
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size <= 0) {
+            return;
+        }
+        reader.Append(buf.data(), size);
+
+        bool broken = false;
+        std::string protocol_error;
+        try {
+            while (reader.Next(&frame)) {
+                batch.push_back({NowNs(), scheduler_.Submit(frame, options_.base, NextSampled())});
+            }
+        } catch (const ProtocolError& error) {
+            broken = true;
+            protocol_error = error.what();
+        }
+
+        out.clear();
+        std::string payload;
+        for (auto& pending : batch) {
+            bool error = AwaitResponse(pending.result, &payload);
+            metrics_.Record(NowNs() - pending.start_ns, error);
+            AppendFrame(&out, options_.framing, payload);
+        }
+        batch.clear();
+        if (broken) {
+            AppendFrame(&out, options_.framing, "error protocol: " + protocol_error);
+        }
+        if (!WriteAll(out_fd, out) || broken) {
+            return;
+        }
+    }
+}
+
+// the request is sampled when it brings the count of the sampled ones up by one,
+// e.g. every fourth at the rate of 0.25
+bool EvalServer::NextSampled() {
+    if (options_.sample_rate <= 0) {
+        return false;
+    }
+    auto number = requests_.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<uint64_t>((number + 1) * options_.sample_rate) !=
+           static_cast<uint64_t>(number * options_.sample_rate);
+}
+
+void EvalServer::ServeUnixSocket(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("socket path is too long");
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    unlink(path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd, SOMAXCONN) < 0) {
+        int error = errno;
+        close(listen_fd);
+        throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(error));
+    }
+
+    // the open connections, each one is served by its own detached thread
+    std::mutex mutex;
+    std::condition_variable closed;
+    std::set<int> connections;
+    while (!stop_.load()) {
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, kAcceptPollMs) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            std::lock_guard lock{mutex};
+            connections.insert(fd);
+        }
+        std::thread([this, fd, &mutex, &closed, &connections] {
+            ServeStream(fd, fd);
+            std::lock_guard lock{mutex};
+            connections.erase(fd);
+            close(fd);
+            closed.notify_all();
+        }).detach();
+    }
+
+    close(listen_fd);
+    unlink(path.c_str());
+    // wakes up the connections blocked in read
+    std::unique_lock lock{mutex};
+    for (int fd : connections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    closed.wait(lock, [&connections] { return connections.empty(); });
+}
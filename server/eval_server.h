@@ -0,0 +1,65 @@
+#pragma once
+
+#include "protocol.h"
+#include "scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+struct ServerOptions {
+    size_t threads = 1;
+    Framing framing = Framing::LINE;
+    EvalBudget slice;
+    // every request is evaluated in a fork of it, so definitions don't leak between requests
+    std::shared_ptr<const Environment> base;
+    // fraction of the requests evaluated inside a SampledRequest, spread evenly
+    double sample_rate = 0;
+};
+
+class ServerMetrics {
+public:
+    ServerMetrics();
+
+    void Record(uint64_t latency_ns, bool error);
+    // e.g. "requests 1000, errors 0, 51234.5 req/s, p50 12.3 us, p99 80.1 us, max 95.0 us"
+    std::string Report() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::chrono::steady_clock::time_point start_;
+    LatencyHistogram latencies_;
+    uint64_t errors_ = 0;
+};
+
+// evaluates the expressions coming over a connection on a Scheduler shared by all
+// connections. every chunk read from a connection is split into requests, which are
+// submitted together; their responses are written back in one batch
+class EvalServer {
+public:
+    explicit EvalServer(ServerOptions options);
+
+    // serves a single connection on the given descriptors until the end of input
+    void ServeStream(int in_fd, int out_fd);
+    // accepts connections on a unix domain socket until Stop
+    void ServeUnixSocket(const std::string& path);
+
+    // may be called from a signal handler
+    void Stop() {
+        stop_.store(true);
+    }
+
+    const ServerMetrics& GetMetrics() const {
+        return metrics_;
+    }
+
+private:
+    bool NextSampled();
+
+    ServerOptions options_;
+    Scheduler scheduler_;
+    ServerMetrics metrics_;
+    std::atomic<uint64_t> requests_ = 0;
+    std::atomic<bool> stop_ = false;
+};
@@ -0,0 +1,172 @@
+// load generator for scheme_server: every connection sends its requests in pipelined
+// batches and waits for the responses of a batch before sending the next one
+//
+// usage: scheme_load --socket PATH [--connections N] [--requests N] [--pipeline N]
+//                    [--framing line|length] [--expr EXPR]...
+// the expressions are sent round-robin, by default "(+ 1 2)"
+
+#include "protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string socket_path;
+    size_t connections = 4;
+    size_t requests = 10000;
+    size_t pipeline = 16;
+    Framing framing = Framing::LINE;
+    std::vector<std::string> exprs;
+};
+
+struct ConnectionResult {
+    LatencyHistogram latencies;
+    uint64_t errors = 0;
+    std::string failure;
+};
+
+uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int Connect(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void RunConnection(const Options& options, size_t id, ConnectionResult* result) {
+    int fd = Connect(options.socket_path);
+    if (fd < 0) {
+        result->failure = "cannot connect to " + options.socket_path;
+        return;
+    }
+
+    FrameReader reader{options.framing};
+    std::string out;
+    std::string frame;
+    char buf[1 << 16];
+    size_t next_expr = id;
+    for (size_t sent = 0; sent < options.requests;) {
+        size_t batch = std::min(options.pipeline, options.requests - sent);
+        out.clear();
+        for (size_t i = 0; i < batch; ++i) {
+            AppendFrame(&out, options.framing, options.exprs[next_expr++ % options.exprs.size()]);
+        }
+        uint64_t start = NowNs();
+        if (write(fd, out.data(), out.size()) != static_cast<ssize_t>(out.size())) {
+            result->failure = "write failed";
+            break;
+        }
+        for (size_t received = 0; received < batch;) {
+            if (reader.Next(&frame)) {
+                result->latencies.Record(NowNs() - start);
+                result->errors += frame.compare(0, 3, "ok ") != 0;
+                ++received;
+                continue;
+            }
+            ssize_t size = read(fd, buf, sizeof(buf));
+            if (size <= 0) {
+                result->failure = "connection closed by the server";
+                close(fd);
+                return;
+            }
+            reader.Append(buf, size);
+        }
+        sent += batch;
+    }
+    close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--socket" && i + 1 < argc) {
+                options.socket_path = argv[++i];
+            } else if (arg == "--connections" && i + 1 < argc) {
+                options.connections = std::stoul(argv[++i]);
+            } else if (arg == "--requests" && i + 1 < argc) {
+                options.requests = std::stoul(argv[++i]);
+            } else if (arg == "--pipeline" && i + 1 < argc) {
+                options.pipeline = std::max<size_t>(std::stoul(argv[++i]), 1);
+            } else if (arg == "--framing" && i + 1 < argc) {
+                options.framing = ParseFraming(argv[++i]);
+            } else if (arg == "--expr" && i + 1 < argc) {
+                options.exprs.push_back(argv[++i]);
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (options.socket_path.empty()) {
+            throw std::invalid_argument("--socket is needed");
+        }
+    } catch (const std::exception&) {
+        std::fprintf(stderr,
+                     "usage: %s --socket PATH [--connections N] [--requests N] [--pipeline N] "
+                     "[--framing line|length] [--expr EXPR]...\n",
+                     argv[0]);
+        return 1;
+    }
+    if (options.exprs.empty()) {
+        options.exprs.push_back("(+ 1 2)");
+    }
+
+    std::vector<ConnectionResult> results(options.connections);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.connections; ++i) {
+        threads.emplace_back(RunConnection, std::cref(options), i, &results[i]);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LatencyHistogram latencies;
+    uint64_t errors = 0;
+    int status = 0;
+    for (auto& result : results) {
+        latencies.Merge(result.latencies);
+        errors += result.errors;
+        if (!result.failure.empty()) {
+            std::fprintf(stderr, "%s\n", result.failure.c_str());
+            status = 1;
+        }
+    }
+    std::printf("connections %zu, pipeline %zu, responses %llu, errors %llu, %.3f s\n",
+                options.connections, options.pipeline,
+                static_cast<unsigned long long>(latencies.GetCount()),
+                static_cast<unsigned long long>(errors), seconds);
+    std::printf("%.1f req/s, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                latencies.GetCount() / seconds, latencies.GetPercentile(0.5) / 1e3,
+                latencies.GetPercentile(0.99) / 1e3, latencies.GetMax() / 1e3);
+    return status;
+}
@@ -0,0 +1,140 @@
+#include "protocol.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// digits of a length header
+constexpr size_t kMaxHeaderSize = 10;
+
+}  // namespace
+
+Framing ParseFraming(const std::string& name) {
+    if (name == "line") {
+        return Framing::LINE;
+    } else if (name == "length") {
+        return Framing::LENGTH;
+    }
+    throw ProtocolError("unknown framing " + name);
+}
+
+void FrameReader::Append(const char* data, size_t size) {
+    // drop the consumed prefix once it outgrows the rest
+    if (pos_ > 0 && pos_ * 2 >= buffer_.size()) {
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+    }
+    buffer_.append(data, size);
+}
+
+bool FrameReader::Next(std::string* frame) {
+    while (true) {
+        size_t end = buffer_.find('\n', pos_);
+        if (end == std::string::npos) {
+            size_t pending = buffer_.size() - pos_;
+            if (framing_ == Framing::LINE && pending > kMaxFrameSize) {
+                throw ProtocolError("frame is too large");
+            } else if (framing_ == Framing::LENGTH && pending > kMaxHeaderSize) {
+                throw ProtocolError("bad frame header");
+            }
+            return false;
+        }
+        if (framing_ == Framing::LINE) {
+            size_t size = end - pos_;
+            if (size > 0 && buffer_[end - 1] == '\r') {
+                --size;
+            }
+            frame->assign(buffer_, pos_, size);
+            pos_ = end + 1;
+            if (frame->find_first_not_of(" \t") == std::string::npos) {
+                continue;
+            }
+            return true;
+        }
+
+        size_t size = 0;
+        if (end == pos_ || end - pos_ > kMaxHeaderSize) {
+            throw ProtocolError("bad frame header");
+        }
+        for (size_t i = pos_; i < end; ++i) {
+            if (buffer_[i] < '0' || buffer_[i] > '9') {
+                throw ProtocolError("bad frame header");
+            }
+            size = size * 10 + (buffer_[i] - '0');
+        }
+        if (size > kMaxFrameSize) {
+            throw ProtocolError("frame is too large");
+        }
+        if (buffer_.size() - end - 1 < size) {
+            return false;
+        }
+        frame->assign(buffer_, end + 1, size);
+        pos_ = end + 1 + size;
+        return true;
+    }
+}
+
+void AppendFrame(std::string* out, Framing framing, const std::string& payload) {
+    if (framing == Framing::LENGTH) {
+        *out += std::to_string(payload.size());
+        *out += '\n';
+        *out += payload;
+    } else {
+        // a line frame can't hold a line break
+        size_t start = out->size();
+        *out += payload;
+        std::replace(out->begin() + start, out->end(), '\n', ' ');
+        *out += '\n';
+    }
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t ns) {
+    if (ns < kSubBuckets) {
+        return ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    size_t sub_bucket = (ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return ((exponent - kSubBucketBits + 1) << kSubBucketBits) + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    int exponent = (bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    uint64_t sub_bucket = bucket & (kSubBuckets - 1);
+    uint64_t width = 1ull << (exponent - kSubBucketBits);
+    // the middle of the bucket
+    return ((kSubBuckets + sub_bucket) << (exponent - kSubBucketBits)) + width / 2;
+}
+
+void LatencyHistogram::Record(uint64_t ns) {
+    ++buckets_[GetBucket(ns)];
+    ++count_;
+    max_ = std::max(max_, ns);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::GetPercentile(double p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::ceil(p * count_));
+    rank = std::clamp<uint64_t>(rank, 1, count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(GetBucketValue(i), max_);
+        }
+    }
+    return max_;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// wire format of the evaluation server.
+//
+// line framing: a request is one line with an expression, a response is one line.
+// length framing: a request is "<size>\n" followed by size bytes of the expression,
+// a response is framed the same way, so expressions may span several lines.
+// the payload of a response is "ok <result>" or "error <kind>: <message>"; responses
+// come in the order of the requests on the connection
+
+enum class Framing { LINE, LENGTH };
+
+struct ProtocolError : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+Framing ParseFraming(const std::string& name);
+
+// splits a byte stream into frames, the bytes may come in arbitrary pieces
+class FrameReader {
+public:
+    // larger frames are refused, so that a peer can't make the buffer grow without bound
+    static constexpr size_t kMaxFrameSize = 16 << 20;
+
+    explicit FrameReader(Framing framing) : framing_(framing) {
+    }
+
+    void Append(const char* data, size_t size);
+    // takes the next complete frame, returns false when there is none yet.
+    // throws ProtocolError on a malformed length header and on a frame, or a line
+    // without its end so far, larger than kMaxFrameSize
+    bool Next(std::string* frame);
+
+private:
+    Framing framing_;
+    std::string buffer_;
+    size_t pos_ = 0;
+};
+
+void AppendFrame(std::string* out, Framing framing, const std::string& payload);
+
+// latencies in nanoseconds, with 16 buckets per power of two, so percentiles are
+// off by at most 1/16 of the value
+class LatencyHistogram {
+public:
+    void Record(uint64_t ns);
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t GetCount() const {
+        return count_;
+    }
+    uint64_t GetMax() const {
+        return max_;
+    }
+    // p in [0, 1]
+    uint64_t GetPercentile(double p) const;
+
+private:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+
+    static size_t GetBucket(uint64_t ns);
+    static uint64_t GetBucketValue(size_t bucket);
+
+    std::array<uint64_t, 64 * kSubBuckets> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
@@ -0,0 +1,179 @@
+// evaluation daemon: serves expressions over a unix domain socket or stdin/stdout and
+// prints throughput and latency percentiles to stderr when it stops
+//
+// usage: scheme_server (--socket PATH | --stdio) [--threads N] [--framing line|length]
+//                      [--slice-steps N] [--report-interval SECONDS] [--prelude FILE]
+//                      [--folded FILE [--sample-rate R]]
+// the prelude has an expression per line, e.g. definitions, evaluated once at start;
+// every request sees its results but not the definitions of the other requests.
+// with --folded, the sampling profiler runs over the fraction R of the requests (all of
+// them by default) and its folded stacks are written to the file on exit
+
+#include "eval_server.h"
+#include "sampler.h"
+#include "scheme.h"
+
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+EvalServer* server = nullptr;
+
+void OnSignal(int) {
+    server->Stop();
+}
+
+InterpreterSnapshot LoadPrelude(const std::string& path) {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    Interpreter interpreter;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        auto res = interpreter.TryRun(line);
+        if (!res) {
+            auto& error = res.GetError();
+            auto where = path + ":" + std::to_string(number);
+            if (error.span.IsKnown()) {
+                where += ":" + std::to_string(error.span.column);
+            }
+            throw std::runtime_error(where + ": " + error.message);
+        }
+    }
+    return interpreter.Snapshot();
+}
+
+void InstallSignalHandlers() {
+    // no SA_RESTART, so that a blocking read returns and sees the stop flag
+    struct sigaction action {};
+    action.sa_handler = OnSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    options.threads = std::thread::hardware_concurrency();
+    std::string socket_path;
+    bool stdio = false;
+    double report_interval = 0;
+    std::string prelude;
+    std::string folded;
+    double sample_rate = 1;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--socket" && i + 1 < argc) {
+                socket_path = argv[++i];
+            } else if (arg == "--stdio") {
+                stdio = true;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                options.threads = std::stoul(argv[++i]);
+            } else if (arg == "--framing" && i + 1 < argc) {
+                options.framing = ParseFraming(argv[++i]);
+            } else if (arg == "--slice-steps" && i + 1 < argc) {
+                options.slice.steps = std::stol(argv[++i]);
+            } else if (arg == "--report-interval" && i + 1 < argc) {
+                report_interval = std::stod(argv[++i]);
+            } else if (arg == "--prelude" && i + 1 < argc) {
+                prelude = argv[++i];
+            } else if (arg == "--folded" && i + 1 < argc) {
+                folded = argv[++i];
+            } else if (arg == "--sample-rate" && i + 1 < argc) {
+                sample_rate = std::stod(argv[++i]);
+                if (!(sample_rate > 0 && sample_rate <= 1)) {
+                    throw std::invalid_argument("--sample-rate is in (0, 1]");
+                }
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (stdio == !socket_path.empty()) {
+            throw std::invalid_argument("one of --socket and --stdio is needed");
+        }
+    } catch (const std::exception&) {
+        std::fprintf(stderr,
+                     "usage: %s (--socket PATH | --stdio) [--threads N] [--framing line|length] "
+                     "[--slice-steps N] [--report-interval SECONDS] [--prelude FILE] "
+                     "[--folded FILE [--sample-rate R]]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    if (!prelude.empty()) {
+        try {
+            options.base = LoadPrelude(prelude);
+        } catch (const std::exception& error) {
+            std::fprintf(stderr, "%s\n", error.what());
+            return 1;
+        }
+    }
+
+    // opened up front, so that a bad path doesn't lose the samples at the end
+    std::ofstream folded_out;
+    if (!folded.empty()) {
+        folded_out.open(folded);
+        if (!folded_out) {
+            std::fprintf(stderr, "cannot open %s\n", folded.c_str());
+            return 1;
+        }
+        options.sample_rate = sample_rate;
+        SamplingProfiler::Start();
+    }
+
+    EvalServer eval_server{options};
+    server = &eval_server;
+    InstallSignalHandlers();
+
+    std::atomic<bool> done = false;
+    std::thread reporter;
+    if (report_interval > 0) {
+        reporter = std::thread([&eval_server, &done, report_interval] {
+            auto next = std::chrono::steady_clock::now();
+            while (!done.load()) {
+                next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(report_interval));
+                while (!done.load() && std::chrono::steady_clock::now() < next) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                std::fprintf(stderr, "%s\n", eval_server.GetMetrics().Report().c_str());
+            }
+        });
+    }
+
+    int status = 0;
+    try {
+        if (stdio) {
+            eval_server.ServeStream(0, 1);
+        } else {
+            eval_server.ServeUnixSocket(socket_path);
+        }
+    } catch (const std::exception& error) {
+        std::fprintf(stderr, "%s\n", error.what());
+        status = 1;
+    }
+
+    done.store(true);
+    if (reporter.joinable()) {
+        reporter.join();
+    } else {
+        std::fprintf(stderr, "%s\n", eval_server.GetMetrics().Report().c_str());
+    }
+    if (!folded.empty()) {
+        SamplingProfiler::Stop();
+        SamplingProfiler::WriteFolded(folded_out);
+    }
+    return status;
+}
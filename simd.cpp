@@ -0,0 +1,230 @@
+#include "simd.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SCHEME_HAS_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+int64_t ScalarSum(const int64_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        sum += static_cast<uint64_t>(data[i]);
+    }
+    return static_cast<int64_t>(sum);
+}
+
+int64_t ScalarMin(const int64_t* data, size_t size) {
+    int64_t res = data[0];
+    for (size_t i = 1; i < size; ++i) {
+        res = data[i] < res ? data[i] : res;
+    }
+    return res;
+}
+
+int64_t ScalarMax(const int64_t* data, size_t size) {
+    int64_t res = data[0];
+    for (size_t i = 1; i < size; ++i) {
+        res = data[i] > res ? data[i] : res;
+    }
+    return res;
+}
+
+void ScalarAdd(const int64_t* lhs, const int64_t* rhs, int64_t* out, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] =
+            static_cast<int64_t>(static_cast<uint64_t>(lhs[i]) + static_cast<uint64_t>(rhs[i]));
+    }
+}
+
+void ScalarMul(const int64_t* lhs, const int64_t* rhs, int64_t* out, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] =
+            static_cast<int64_t>(static_cast<uint64_t>(lhs[i]) * static_cast<uint64_t>(rhs[i]));
+    }
+}
+
+int64_t ScalarDot(const int64_t* lhs, const int64_t* rhs, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        sum += static_cast<uint64_t>(lhs[i]) * static_cast<uint64_t>(rhs[i]);
+    }
+    return static_cast<int64_t>(sum);
+}
+
+#ifdef SCHEME_HAS_AVX2_KERNELS
+
+constexpr size_t kLanes = 4;
+
+bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+__attribute__((target("avx2"))) int64_t HorizontalSum(__m256i v) {
+    alignas(32) int64_t lanes[kLanes];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    return ScalarSum(lanes, kLanes);
+}
+
+// avx2 has no 64 bit multiply, so it is put together from 32 bit halves.
+// the high half of the product is lost anyway, so only three multiplies are needed
+__attribute__((target("avx2"))) __m256i MulLo64(__m256i a, __m256i b) {
+    __m256i lo_lo = _mm256_mul_epu32(a, b);
+    __m256i lo_hi = _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32));
+    __m256i hi_lo = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+    __m256i cross = _mm256_slli_epi64(_mm256_add_epi64(lo_hi, hi_lo), 32);
+    return _mm256_add_epi64(lo_lo, cross);
+}
+
+__attribute__((target("avx2"))) int64_t Avx2Sum(const int64_t* data, size_t size) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 2 * kLanes <= size; i += 2 * kLanes) {
+        acc0 = _mm256_add_epi64(
+            acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        acc1 = _mm256_add_epi64(
+            acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + kLanes)));
+    }
+    uint64_t sum = HorizontalSum(_mm256_add_epi64(acc0, acc1));
+    sum += ScalarSum(data + i, size - i);
+    return static_cast<int64_t>(sum);
+}
+
+__attribute__((target("avx2"))) int64_t Avx2Min(const int64_t* data, size_t size) {
+    if (size < kLanes) {
+        return ScalarMin(data, size);
+    }
+    __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    size_t i = kLanes;
+    for (; i + kLanes <= size; i += kLanes) {
+        __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc = _mm256_blendv_epi8(acc, cur, _mm256_cmpgt_epi64(acc, cur));
+    }
+    alignas(32) int64_t lanes[kLanes];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int64_t res = ScalarMin(lanes, kLanes);
+    if (i < size) {
+        int64_t tail = ScalarMin(data + i, size - i);
+        res = tail < res ? tail : res;
+    }
+    return res;
+}
+
+__attribute__((target("avx2"))) int64_t Avx2Max(const int64_t* data, size_t size) {
+    if (size < kLanes) {
+        return ScalarMax(data, size);
+    }
+    __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    size_t i = kLanes;
+    for (; i + kLanes <= size; i += kLanes) {
+        __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc = _mm256_blendv_epi8(acc, cur, _mm256_cmpgt_epi64(cur, acc));
+    }
+    alignas(32) int64_t lanes[kLanes];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int64_t res = ScalarMax(lanes, kLanes);
+    if (i < size) {
+        int64_t tail = ScalarMax(data + i, size - i);
+        res = tail > res ? tail : res;
+    }
+    return res;
+}
+
+__attribute__((target("avx2"))) void Avx2Add(const int64_t* lhs, const int64_t* rhs,
+                                             int64_t* out, size_t size) {
+    size_t i = 0;
+    for (; i + kLanes <= size; i += kLanes) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(a, b));
+    }
+    ScalarAdd(lhs + i, rhs + i, out + i, size - i);
+}
+
+__attribute__((target("avx2"))) void Avx2Mul(const int64_t* lhs, const int64_t* rhs,
+                                             int64_t* out, size_t size) {
+    size_t i = 0;
+    for (; i + kLanes <= size; i += kLanes) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), MulLo64(a, b));
+    }
+    ScalarMul(lhs + i, rhs + i, out + i, size - i);
+}
+
+__attribute__((target("avx2"))) int64_t Avx2Dot(const int64_t* lhs, const int64_t* rhs,
+                                                size_t size) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + kLanes <= size; i += kLanes) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        acc = _mm256_add_epi64(acc, MulLo64(a, b));
+    }
+    uint64_t sum = HorizontalSum(acc);
+    sum += ScalarDot(lhs + i, rhs + i, size - i);
+    return static_cast<int64_t>(sum);
+}
+
+#endif
+
+}  // namespace
+
+int64_t SimdSum(const int64_t* data, size_t size) {
+#ifdef SCHEME_HAS_AVX2_KERNELS
+    if (HasAvx2()) {
+        return Avx2Sum(data, size);
+    }
+#endif
+    return ScalarSum(data, size);
+}
+
+int64_t SimdMin(const int64_t* data, size_t size) {
+#ifdef SCHEME_HAS_AVX2_KERNELS
+    if (HasAvx2()) {
+        return Avx2Min(data, size);
+    }
+#endif
+    return ScalarMin(data, size);
+}
+
+int64_t SimdMax(const int64_t* data, size_t size) {
+#ifdef SCHEME_HAS_AVX2_KERNELS
+    if (HasAvx2()) {
+        return Avx2Max(data, size);
+    }
+#endif
+    return ScalarMax(data, size);
+}
+
+void SimdAdd(const int64_t* lhs, const int64_t* rhs, int64_t* out, size_t size) {
+#ifdef SCHEME_HAS_AVX2_KERNELS
+    if (HasAvx2()) {
+        Avx2Add(lhs, rhs, out, size);
+        return;
+    }
+#endif
+    ScalarAdd(lhs, rhs, out, size);
+}
+
+void SimdMul(const int64_t* lhs, const int64_t* rhs, int64_t* out, size_t size) {
+#ifdef SCHEME_HAS_AVX2_KERNELS
+    if (HasAvx2()) {
+        Avx2Mul(lhs, rhs, out, size);
+        return;
+    }
+#endif
+    ScalarMul(lhs, rhs, out, size);
+}
+
+int64_t SimdDot(const int64_t* lhs, const int64_t* rhs, size_t size) {
+#ifdef SCHEME_HAS_AVX2_KERNELS
+    if (HasAvx2()) {
+        return Avx2Dot(lhs, rhs, size);
+    }
+#endif
+    return ScalarDot(lhs, rhs, size);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// kernels over packed int64 buffers, picked at runtime: avx2 when the cpu has it,
+// plain loops otherwise. overflow wraps around like in the rest of the arithmetic
+
+int64_t SimdSum(const int64_t* data, size_t size);
+
+// size must be non zero
+int64_t SimdMin(const int64_t* data, size_t size);
+int64_t SimdMax(const int64_t* data, size_t size);
+
+void SimdAdd(const int64_t* lhs, const int64_t* rhs, int64_t* out, size_t size);
+void SimdMul(const int64_t* lhs, const int64_t* rhs, int64_t* out, size_t size);
+int64_t SimdDot(const int64_t* lhs, const int64_t* rhs, size_t size);
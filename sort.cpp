@@ -0,0 +1,187 @@
+#include "sort.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// below this the threads cost more than they save
+constexpr size_t kParallelThreshold = 1 << 15;
+
+enum class Order { NONE, ASCENDING, DESCENDING };
+
+Order GetNumericOrder(const std::shared_ptr<Object>& less) {
+    if (Is<IsIncrease>(less) || Is<IsNonDecrease>(less)) {
+        return Order::ASCENDING;
+    } else if (Is<IsDecrease>(less) || Is<IsNonIncrease>(less)) {
+        return Order::DESCENDING;
+    }
+    return Order::NONE;
+}
+
+// sorts chunks on the pool, then merges neighbouring runs pairwise, each round in parallel
+template <class Compare>
+void ParallelSort(std::vector<int64_t>& keys, Compare comp) {
+    auto& pool = ThreadPool::Global();
+    size_t threads = pool.GetThreadCount();
+    if (threads == 1 || keys.size() < kParallelThreshold) {
+        std::sort(keys.begin(), keys.end(), comp);
+        return;
+    }
+
+    size_t runs = threads;
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= runs; ++i) {
+        bounds.push_back(keys.size() * i / runs);
+    }
+    pool.ParallelFor(runs, [&](size_t run) {
+        std::sort(keys.begin() + bounds[run], keys.begin() + bounds[run + 1], comp);
+    });
+
+    std::vector<int64_t> buffer(keys.size());
+    while (bounds.size() > 2) {
+        size_t pairs = (bounds.size() - 1) / 2;
+        pool.ParallelFor((bounds.size()) / 2, [&](size_t pair) {
+            size_t begin = bounds[2 * pair];
+            if (pair == pairs) {
+                // odd run out, copied as is
+                std::copy(keys.begin() + begin, keys.end(), buffer.begin() + begin);
+                return;
+            }
+            size_t middle = bounds[2 * pair + 1];
+            size_t end = bounds[2 * pair + 2];
+            std::merge(keys.begin() + begin, keys.begin() + middle, keys.begin() + middle,
+                       keys.begin() + end, buffer.begin() + begin, comp);
+        });
+        keys.swap(buffer);
+
+        std::vector<size_t> merged;
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+        }
+        if (merged.back() != keys.size()) {
+            merged.push_back(keys.size());
+        }
+        bounds.swap(merged);
+    }
+}
+
+std::shared_ptr<Object> SortNumbers(const std::vector<std::shared_ptr<Object>>& elems,
+                                    Order order) {
+    std::vector<int64_t> keys;
+    keys.reserve(elems.size());
+    for (auto& el : elems) {
+        keys.push_back(As<Number>(el)->GetValue());
+    }
+    if (order == Order::ASCENDING) {
+        ParallelSort(keys, std::less<int64_t>{});
+    } else {
+        ParallelSort(keys, std::greater<int64_t>{});
+    }
+
+    std::shared_ptr<Object> list;
+    for (size_t i = keys.size(); i-- > 0;) {
+        auto cell = std::make_shared<Cell>();
+        cell->SetFirst(std::make_shared<Number>(ConstantToken{keys[i]}));
+        cell->SetSecond(list);
+        list = cell;
+    }
+    return list;
+}
+
+std::shared_ptr<Cell> Next(const std::shared_ptr<Cell>& cell) {
+    return std::static_pointer_cast<Cell>(cell->GetSecond());
+}
+
+// bottom-up merge sort of a linked list: runs of width 1, 2, 4, ... are merged by
+// relinking the cells, so no memory is needed besides a few pointers.
+// taking from the left run on ties keeps it stable
+std::shared_ptr<Object> SortCells(std::shared_ptr<Cell> head,
+                                  const std::shared_ptr<Object>& less) {
+    auto is_less = [&less](const std::shared_ptr<Cell>& lhs, const std::shared_ptr<Cell>& rhs) {
+        auto res = less->Apply(MakeArgs({lhs->GetFirst(), rhs->GetFirst()}));
+        return !Is<Bool>(res) || As<Bool>(res)->IsTrue();
+    };
+
+    for (size_t width = 1;; width *= 2) {
+        auto left = head;
+        std::shared_ptr<Cell> tail;
+        head = nullptr;
+        size_t merges = 0;
+        while (left) {
+            ++merges;
+            auto right = left;
+            size_t left_size = 0;
+            while (right && left_size < width) {
+                ++left_size;
+                right = Next(right);
+            }
+            size_t right_size = width;
+
+            while (left_size > 0 || (right_size > 0 && right)) {
+                std::shared_ptr<Cell> cur;
+                if (left_size == 0) {
+                    cur = right;
+                    right = Next(right);
+                    --right_size;
+                } else if (right_size == 0 || !right || !is_less(right, left)) {
+                    cur = left;
+                    left = Next(left);
+                    --left_size;
+                } else {
+                    cur = right;
+                    right = Next(right);
+                    --right_size;
+                }
+                if (tail) {
+                    tail->SetSecond(cur);
+                } else {
+                    head = cur;
+                }
+                tail = cur;
+            }
+            left = right;
+        }
+        tail->SetSecond(nullptr);
+        if (merges <= 1) {
+            return head;
+        }
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<Object> Sort::Apply(const std::shared_ptr<Object>& args) {
+    std::vector<std::shared_ptr<Object>> obj;
+    GetVector(args, obj);
+    if (obj.size() != 2) {
+        throw RuntimeError("cnt of args is not valid");
+    }
+    if (obj[0] && !Is<Cell>(obj[0])) {
+        throw RuntimeError("type of args is not valid");
+    }
+    if (!obj[1]) {
+        throw RuntimeError("not a function");
+    }
+    std::vector<std::shared_ptr<Object>> elems;
+    GetRawVector(obj[0], elems);
+    if (elems.empty()) {
+        return nullptr;
+    }
+
+    auto order = GetNumericOrder(obj[1]);
+    if (order != Order::NONE && ValidateObj<Number>(elems)) {
+        return SortNumbers(elems, order);
+    }
+
+    // the list may be a quoted part of the program, so its cells are not reused
+    std::shared_ptr<Cell> head;
+    for (size_t i = elems.size(); i-- > 0;) {
+        auto cell = std::make_shared<Cell>();
+        cell->SetFirst(elems[i]);
+        cell->SetSecond(head);
+        head = cell;
+    }
+    return SortCells(head, obj[1]);
+}
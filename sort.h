@@ -0,0 +1,11 @@
+#pragma once
+
+#include "object.h"
+
+// (sort list less?)
+// when less? is one of the numeric comparisons, the numbers are sorted as plain
+// int64 keys (in parallel for large lists) and the list is rebuilt from them.
+// any other comparator gets a stable merge sort relinking the cells of a copy of the list
+class Sort : public Func {
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& args) override;
+};
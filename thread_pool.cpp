@@ -0,0 +1,176 @@
+#include "thread_pool.h"
+#include "scheduler.h"
+#include "environment.h"
+#include "memory_stats.h"
+
+#include <chrono>
+
+namespace {
+
+// index of the worker running on this thread in its pool, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+std::mutex global_mutex;
+std::unique_ptr<ThreadPool> global_pool;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    size_t workers = threads > 1 ? threads - 1 : 0;
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread([this, i] { WorkerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{sleep_mutex_};
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void ThreadPool::Push(Task task) {
+    size_t queue = current_pool == this ? current_worker : next_queue_++ % workers_.size();
+    {
+        std::lock_guard lock{workers_[queue]->mutex};
+        workers_[queue]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock{sleep_mutex_};
+        ++pending_;
+    }
+    sleep_cv_.notify_one();
+}
+
+bool ThreadPool::TryRunOne(size_t self) {
+    Task task;
+    for (size_t i = 0; i < workers_.size() && !task; ++i) {
+        size_t victim = (self + i) % workers_.size();
+        std::lock_guard lock{workers_[victim]->mutex};
+        auto& tasks = workers_[victim]->tasks;
+        if (tasks.empty()) {
+            continue;
+        }
+        if (i == 0 && current_pool == this) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    --pending_;
+    task();
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t self) {
+    current_pool = this;
+    current_worker = self;
+    while (true) {
+        if (TryRunOne(self)) {
+            continue;
+        }
+        std::unique_lock lock{sleep_mutex_};
+        sleep_cv_.wait(lock, [this] { return stop_ || pending_ > 0; });
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    // the waiting thread holds the job on its stack, a scheduled evaluation
+    // must not be suspended and resumed elsewhere meanwhile
+    NonPreemptibleScope non_preemptible;
+    if (workers_.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    struct Job {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining;
+        std::vector<std::exception_ptr> errors;
+        uint64_t allocations = 0;
+    } job;
+    job.remaining = count;
+    job.errors.resize(count);
+
+    // the definitions of the interpreter stay visible to the body on every thread
+    auto env = Environment::GetCurrent();
+    for (size_t i = 0; i < count; ++i) {
+        Push([&job, &body, env, i] {
+            EnvironmentScope env_scope{env};
+            // the allocations are taken off the thread, whichever it is, and given to the
+            // waiting one, so that they count in its run and its slice of the scheduler
+            auto thread_allocations = MemoryTracker::GetThreadAllocations();
+            std::exception_ptr error;
+            try {
+                body(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            auto allocations = MemoryTracker::ExchangeThreadAllocations(thread_allocations) -
+                               thread_allocations;
+            // the waiting thread may destroy the job as soon as the lock is released
+            std::lock_guard lock{job.mutex};
+            job.errors[i] = error;
+            job.allocations += allocations;
+            if (--job.remaining == 0) {
+                job.done.notify_all();
+            }
+        });
+    }
+
+    size_t self = current_pool == this ? current_worker : 0;
+    while (true) {
+        {
+            std::lock_guard lock{job.mutex};
+            if (job.remaining == 0) {
+                break;
+            }
+        }
+        if (!TryRunOne(self)) {
+            // the rest is being executed by other threads
+            std::unique_lock lock{job.mutex};
+            job.done.wait_for(lock, std::chrono::milliseconds(1),
+                              [&job] { return job.remaining == 0; });
+        }
+    }
+    MemoryTracker::ExchangeThreadAllocations(MemoryTracker::GetThreadAllocations() +
+                                             job.allocations);
+
+    for (auto& error : job.errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+ThreadPool& ThreadPool::Global() {
+    std::lock_guard lock{global_mutex};
+    if (!global_pool) {
+        global_pool = std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+    }
+    return *global_pool;
+}
+
+void ThreadPool::SetGlobalThreadCount(size_t threads) {
+    std::lock_guard lock{global_mutex};
+    global_pool = std::make_unique<ThreadPool>(threads);
+}
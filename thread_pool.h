@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work-stealing pool: every worker owns a deque, takes its own tasks from the back
+// and steals from the front of the others when it runs out of work
+class ThreadPool {
+public:
+    // the thread calling ParallelFor takes part in the work too,
+    // so a pool of n threads starts n - 1 workers
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    // runs body(i) for every i in [0, count) and returns when all of them are done.
+    // may be nested: a waiting thread keeps executing pending tasks.
+    // if some calls throw, the exception of the smallest index is rethrown
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // pool used by the parallel builtins
+    static ThreadPool& Global();
+    // must not be called while the global pool is running something
+    static void SetGlobalThreadCount(size_t threads);
+
+private:
+    using Task = std::function<void()>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void Push(Task task);
+    bool TryRunOne(size_t self);
+    void WorkerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_queue_ = 0;
+    std::atomic<size_t> pending_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_ = false;
+};
@@ -1,5 +1,9 @@
 #include "tokenizer.h"
 #include "error.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <cctype>
 
 bool SymbolToken::operator==(const SymbolToken& other) const {
     return name == other.name;
@@ -13,118 +17,235 @@ bool DotToken::operator==(const DotToken&) const {
 bool ConstantToken::operator==(const ConstantToken& other) const {
     return value == other.value;
 }
+bool StringToken::operator==(const StringToken& other) const {
+    return value == other.value;
+}
+bool CharToken::operator==(const CharToken& other) const {
+    return value == other.value;
+}
+
+namespace {
+
+bool IsSpace(int ch) {
+    return ch != EOF && std::isspace(static_cast<unsigned char>(ch));
+}
+
+bool IsDigit(int ch) {
+    return ch != EOF && std::isdigit(static_cast<unsigned char>(ch));
+}
+
+bool IsSymbolStart(int ch) {
+    return ch != EOF && (std::isalpha(static_cast<unsigned char>(ch)) || ch == '<' || ch == '=' ||
+                         ch == '>' || ch == '*' || ch == '#');
+}
+
+bool IsSymbolChar(int ch) {
+    return IsSymbolStart(ch) || IsDigit(ch) || ch == '?' || ch == '!' || ch == '-';
+}
+
+uint16_t Clamp(size_t value) {
+    return std::min<size_t>(value, UINT16_MAX);
+}
+
+}  // namespace
 
 Tokenizer::Tokenizer(std::istream* in) : in_(in) {
-    Next();
+    TryNext();
 }
 
-void Tokenizer::Next() {
-    std::set<char> first_pack{'<', '=', '>', '*', '#'};
-    std::set<char> second_pack{'<', '=', '>', '*', '#', '?', '!', '-'};
+char Tokenizer::Get() {
+    char ch = in_->get();
+    ++offset_;
+    if (ch == '\n') {
+        ++line_;
+        column_ = 1;
+    } else {
+        ++column_;
+    }
+    return ch;
+}
 
-    char ch = in_->peek();
-    if (ch == EOF) {
-        is_end_ = true;
-        return;
+bool Tokenizer::Fail(std::string message) {
+    span_.length = Clamp(offset_ - token_offset_);
+    error_ = {ErrorKind::SYNTAX, std::move(message), span_};
+    has_error_ = true;
+    is_end_ = true;
+    return false;
+}
+
+bool Tokenizer::ReadNumber(bool negative) {
+    // the magnitude is accumulated unsigned, so that INT64_MIN fits as well
+    uint64_t limit = negative ? uint64_t{1} << 63 : INT64_MAX;
+    uint64_t value = 0;
+    bool overflow = false;
+    while (IsDigit(in_->peek())) {
+        uint64_t digit = Get() - '0';
+        if (value > (limit - digit) / 10) {
+            overflow = true;
+        } else {
+            value = value * 10 + digit;
+        }
+    }
+    if (overflow) {
+        return Fail("number is out of range");
     }
+    next_ = ConstantToken{static_cast<int64_t>(negative ? 0 - value : value)};
+    return true;
+}
 
-    while (std::isspace(ch)) {
-        in_->get();
-        ch = in_->peek();
+bool Tokenizer::ReadString() {
+    std::string value;
+    while (true) {
+        int ch = in_->peek();
         if (ch == EOF) {
-            is_end_ = true;
-            return;
+            return Fail("string is not closed");
+        }
+        Get();
+        if (ch == '"') {
+            break;
+        } else if (ch != '\\') {
+            value += static_cast<char>(ch);
+            continue;
         }
+        ch = in_->peek();
+        if (ch == '"' || ch == '\\') {
+            value += static_cast<char>(ch);
+        } else if (ch == 'n') {
+            value += '\n';
+        } else if (ch == 't') {
+            value += '\t';
+        } else if (ch == 'r') {
+            value += '\r';
+        } else if (ch == 'x') {
+            Get();
+            int code = 0;
+            size_t digits = 0;
+            for (; std::isxdigit(in_->peek()); ++digits) {
+                int digit = std::tolower(Get());
+                code = code * 16 + (std::isdigit(digit) ? digit - '0' : digit - 'a' + 10);
+                if (code > 0xff) {
+                    return Fail("escape is out of range");
+                }
+            }
+            if (digits == 0 || in_->peek() != ';') {
+                return Fail("unknown escape in string");
+            }
+            value += static_cast<char>(code);
+        } else {
+            return Fail("unknown escape in string");
+        }
+        Get();
+    }
+    next_ = StringToken{std::move(value)};
+    return true;
+}
+
+bool Tokenizer::ReadChar() {
+    int ch = in_->peek();
+    if (ch == EOF) {
+        return Fail("character is not given");
+    }
+    std::string name(1, Get());
+    while (std::isalpha(static_cast<unsigned char>(name[0])) && IsSymbolChar(in_->peek())) {
+        name += Get();
+    }
+    if (name.size() == 1) {
+        next_ = CharToken{name[0]};
+    } else if (name == "space") {
+        next_ = CharToken{' '};
+    } else if (name == "newline") {
+        next_ = CharToken{'\n'};
+    } else if (name == "tab") {
+        next_ = CharToken{'\t'};
+    } else {
+        return Fail("unknown character #\\" + name);
+    }
+    return true;
+}
+
+void Tokenizer::Next() {
+    if (!TryNext()) {
+        error_.Throw();
+    }
+}
+
+bool Tokenizer::TryNext() {
+    SCHEME_PROFILE_SCOPE("<tokenize>");
+    int ch = in_->peek();
+    while (IsSpace(ch)) {
+        Get();
+        ch = in_->peek();
+    }
+    token_offset_ = offset_;
+    span_ = {line_, Clamp(column_), 0};
+    if (ch == EOF) {
+        is_end_ = true;
+        return true;
     }
 
     if (ch == '\'') {
-        in_->get();
+        Get();
         next_ = QuoteToken{};
-        is_end_ = false;
     } else if (ch == '.') {
-        in_->get();
+        Get();
         next_ = DotToken{};
-        is_end_ = false;
     } else if (ch == '(') {
-        in_->get();
+        Get();
         next_ = BracketToken::OPEN;
-        is_end_ = false;
     } else if (ch == ')') {
-        in_->get();
+        Get();
         next_ = BracketToken::CLOSE;
-        is_end_ = false;
     } else if (ch == '*' || ch == '/') {
-        in_->get();
-        std::string s;
-        s += ch;
-        next_ = SymbolToken{s};
-        is_end_ = false;
+        next_ = SymbolToken{std::string(1, Get())};
     } else if (ch == '+' || ch == '-') {
-        in_->get();
-        char next_ch = in_->peek();
-        if (next_ch == EOF || std::isspace(next_ch)) {
-            std::string s;
-            s += ch;
-            next_ = SymbolToken{s};
-        } else if (std::isdigit(next_ch)) {
-            std::string num;
-            while (std::isdigit(next_ch)) {
-                num += next_ch;
-                in_->get();
-                next_ch = in_->peek();
-            }
-            if (ch == '+') {
-                next_ = ConstantToken{std::stoi(num)};
-            } else {
-                next_ = ConstantToken{std::stoi(num) * (-1)};
+        Get();
+        if (IsDigit(in_->peek())) {
+            if (!ReadNumber(ch == '-')) {
+                return false;
             }
         } else {
-            std::string s;
-            s += ch;
-            next_ = SymbolToken{s};
+            next_ = SymbolToken{std::string(1, ch)};
         }
-        is_end_ = false;
-    } else if (std::isdigit(ch)) {
-        std::string num;
-        num += ch;
-        ch = in_->get();
-        ch = in_->peek();
-        while (ch != EOF && !std::isspace(ch) && std::isdigit(ch)) {
-            num += ch;
-            in_->get();
-            ch = in_->peek();
+    } else if (IsDigit(ch)) {
+        if (!ReadNumber(false)) {
+            return false;
+        }
+    } else if (ch == '"') {
+        Get();
+        if (!ReadString()) {
+            return false;
         }
-        next_ = ConstantToken{std::stoi(num)};
-        is_end_ = false;
     } else if (ch == '#') {
-        in_->get();
+        Get();
         ch = in_->peek();
         if (ch == 't') {
+            Get();
             next_ = BoolToken::TRUE;
         } else if (ch == 'f') {
+            Get();
             next_ = BoolToken::FALSE;
+        } else if (ch == '\\') {
+            Get();
+            if (!ReadChar()) {
+                return false;
+            }
         } else {
-            throw SyntaxError("");
+            return Fail("expected #t, #f or a character");
         }
-        in_->get();
-        is_end_ = false;
-    } else if (std::isalpha(ch) || first_pack.find(ch) != first_pack.end()) {
+    } else if (IsSymbolStart(ch)) {
         std::string s;
-        s += ch;
-        in_->get();
-        ch = in_->peek();
-        while (
-            ch != EOF && !std::isspace(ch) &&
-            (std::isalpha(ch) || std::isdigit(ch) || second_pack.find(ch) != second_pack.end())) {
-            s += ch;
-            in_->get();
-            ch = in_->peek();
+        s += Get();
+        while (IsSymbolChar(in_->peek())) {
+            s += Get();
         }
-        next_ = SymbolToken{s};
-        is_end_ = false;
+        next_ = SymbolToken{std::move(s)};
     } else {
-        throw SyntaxError("");
+        Get();
+        return Fail(std::string("unexpected character '") + static_cast<char>(ch) + "'");
     }
+    span_.length = Clamp(offset_ - token_offset_);
+    is_end_ = false;
+    return true;
 }
 
 bool Tokenizer::IsEnd() {
@@ -7,6 +7,8 @@
 #include <exception>
 #include <set>
 
+#include "error.h"
+
 struct SymbolToken {
     std::string name;
 
@@ -31,21 +33,75 @@ struct ConstantToken {
     bool operator==(const ConstantToken& other) const;
 };
 
-using Token =
-    std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken, BoolToken>;
+// "text", with the escapes \" \\ \n \t \r and \xHH; for any byte, e.g. \x0; for nul
+struct StringToken {
+    std::string value;
+
+    bool operator==(const StringToken& other) const;
+};
+
+// #\a, #\space, #\newline, #\tab
+struct CharToken {
+    char value;
+
+    bool operator==(const CharToken& other) const;
+};
+
+using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken,
+                           BoolToken, StringToken, CharToken>;
 
 class Tokenizer {
 public:
+    // reads the first token, an error in it is kept for GetError instead of being thrown
     Tokenizer(std::istream* in);
 
+    // also true after an error
     bool IsEnd();
 
+    // throws SyntaxError on a malformed token
     void Next();
+    // the same without exceptions, false on a malformed token
+    bool TryNext();
 
     Token GetToken();
 
+    // of the current token, or of the end of the input when IsEnd
+    SourceSpan GetSpan() const {
+        return span_;
+    }
+    // characters before the current token
+    size_t GetOffset() const {
+        return token_offset_;
+    }
+
+    bool HasError() const {
+        return has_error_;
+    }
+    const Diagnostic& GetError() const {
+        return error_;
+    }
+
 private:
+    // takes a character, keeping track of the position
+    char Get();
+    // the digits at the front of the input, negated when negative
+    bool ReadNumber(bool negative);
+    // after the opening quote
+    bool ReadString();
+    // after the #\ that starts a character
+    bool ReadChar();
+    bool Fail(std::string message);
+
     std::istream* in_;
     Token next_;
     bool is_end_ = false;
+
+    uint32_t line_ = 1;
+    uint32_t column_ = 1;
+    size_t offset_ = 0;
+    size_t token_offset_ = 0;
+    SourceSpan span_;
+
+    bool has_error_ = false;
+    Diagnostic error_;
 };